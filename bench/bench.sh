@@ -0,0 +1,78 @@
+#!/bin/bash
+#
+# bench.sh - aspp benchmark on synthetic assembler sources.
+#
+# This is free and unencumbered software released into the public domain.
+# For more information, please refer to <http://unlicense.org>.
+#
+# Usage:
+#     bench.sh <aspp> <runstat> <work directory> [size [runs [aspp options]]]
+#
+# Generates every shape of sources (see "gen.sh") of the given size (1000 by
+# default) in both syntaxes and runs "aspp -E -M" on each one several times
+# (3 by default). The best run is reported: number of files and their total
+# size, wall time, files/s, MB/s and peak RSS.
+#
+set -e
+
+if [[ $# -lt 3 ]]; then
+    echo "Usage: $0 <aspp> <runstat> <work directory> [size [runs [aspp options]]]" >&2
+    exit 1
+fi
+
+aspp=$(realpath "$1")
+runstat=$(realpath "$2")
+work="$3"
+size="${4:-1000}"
+declare -i runs="${5:-3}"
+opts="$6"
+gen="$(dirname "$(realpath "$0")")/gen.sh"
+
+shapes='fanout deep tree diamond data incdirs'
+syntaxes='tasm sjasm'
+
+mkdir -p "$work"
+
+# $1 = number of bytes, $2 = time in ns
+# Prints MB/s with 1 decimal digit.
+mbps() {
+    local -i x=$(($1 * 10000000000 / 1048576 / $2))
+    echo "$((x / 10)).$((x % 10))"
+}
+
+printf '%-8s %-6s %7s %9s %10s %10s %9s %10s\n' \
+    shape syntax files KiB 'time, ms' files/s MB/s 'RSS, KiB'
+
+for shape in $shapes; do
+    for syntax in $syntaxes; do
+        dir="$work/$syntax-$shape"
+        bash "$gen" "$dir" "$syntax" "$shape" "$size"
+        read -r args < "$dir/args"
+        declare -i files=0 bytes=0 best=0 rss=0
+        files=$(find "$dir" -type f -name '*.inc' -o -type f -name '*.asm' | wc -l)
+        bytes=$(find "$dir" -type f \( -name '*.inc' -o -name '*.asm' \) -printf '%s\n' | \
+            awk '{ s += $1 } END { print s + 0 }')
+        for ((r = 0; r < runs; r++)); do
+            # Word splitting of "args" and "opts" is intended
+            # shellcheck disable=SC2086
+            read -r t m st < <(cd "$dir" && "$runstat" "$aspp" $opts --syntax "$syntax" \
+                -E -M -MF out.d -MT main.o $args)
+            if [[ $st -ne 0 ]]; then
+                echo "aspp failed (status $st) on '$dir'." >&2
+                exit 1
+            fi
+            if [[ $best -eq 0 || $t -lt $best ]]; then
+                best=$t
+            fi
+            if [[ $m -gt $rss ]]; then
+                rss=$m
+            fi
+        done
+        if [[ $best -lt 1 ]]; then
+            best=1
+        fi
+        printf '%-8s %-6s %7u %9u %10u %10u %9s %10u\n' \
+            "$shape" "$syntax" "$files" "$((bytes / 1024))" "$((best / 1000000))" \
+            "$((files * 1000000000 / best))" "$(mbps "$bytes" "$best")" "$rss"
+    done
+done
@@ -0,0 +1,165 @@
+#!/bin/bash
+#
+# gen.sh - synthetic assembler sources generator for aspp benchmarks.
+#
+# This is free and unencumbered software released into the public domain.
+# For more information, please refer to <http://unlicense.org>.
+#
+# Usage:
+#     gen.sh <directory> <syntax> <shape> <size>
+# where:
+#     <syntax> is one of: tasm, sjasm
+#     <shape> is one of:
+#         fanout  - main file includes <size> files directly
+#         deep    - chain of <size> nested files
+#         tree    - binary tree of <size> files, each one includes two files
+#                   of the next level
+#         diamond - layers of 8 files, each one includes two files of the next
+#                   layer (<size> files total)
+#         data    - main file includes <size> data-only files of 64 KiB
+#         incdirs - main file includes <size> files found in the last of 32
+#                   include directories
+#
+# The directory is created anew. Arguments for aspp (include directories and
+# main file name relative to the directory) are written to "args" file in it.
+#
+set -e
+
+if [[ $# -ne 4 ]]; then
+    echo "Usage: $0 <directory> <syntax> <shape> <size>" >&2
+    exit 1
+fi
+
+dir="$1"
+syntax="$2"
+shape="$3"
+declare -i size="$4"
+
+case "$syntax" in
+tasm)
+    # Directive starts a line
+    ind=''
+    ;;
+sjasm)
+    # Directive must be indented
+    ind=$'\t'
+    ;;
+*)
+    echo "Unknown syntax '$syntax'." >&2
+    exit 1
+    ;;
+esac
+
+if [[ $size -lt 1 ]]; then
+    echo "Bad size '$4'." >&2
+    exit 1
+fi
+
+# Common code lines of every file
+body=''
+for ((i = 0; i < 40; i++)); do
+    body+="l$i:"$'\tld a,(ix+'"$i"$')\t; load next value\n'
+    body+=$'\tadd a,b\n'
+done
+
+# $1 = file name, $2... = included file names
+put_file() {
+    local f="$1" s='' i
+    shift
+    for i in "$@"; do
+        s+="$ind"'include "'"$i"$'"\n'
+    done
+    printf '%s%s' "$s" "$body" > "$f"
+}
+
+rm -rf "$dir"
+mkdir -p "$dir"
+cd "$dir"
+
+declare -a names
+args=''
+
+case "$shape" in
+fanout)
+    for ((i = 0; i < size; i++)); do
+        put_file "f$i.inc"
+        names+=("f$i.inc")
+    done
+    put_file main.asm "${names[@]}"
+    ;;
+deep)
+    for ((i = 0; i < size - 1; i++)); do
+        put_file "d$i.inc" "d$((i + 1)).inc"
+    done
+    put_file "d$((size - 1)).inc"
+    put_file main.asm d0.inc
+    ;;
+tree)
+    for ((i = 0; i < size; i++)); do
+        names=()
+        for c in $((2 * i + 1)) $((2 * i + 2)); do
+            if [[ $c -lt $size ]]; then
+                names+=("t$c.inc")
+            fi
+        done
+        put_file "t$i.inc" "${names[@]}"
+    done
+    put_file main.asm t0.inc
+    ;;
+diamond)
+    declare -i w=8 layers
+    layers=$(((size + 7) / 8))
+    for ((l = 0; l < layers; l++)); do
+        for ((i = 0; i < w; i++)); do
+            if [[ $l -eq $((layers - 1)) ]]; then
+                put_file "n${l}_$i.inc"
+            else
+                put_file "n${l}_$i.inc" "n$((l + 1))_$i.inc" "n$((l + 1))_$(((i + 1) % w)).inc"
+            fi
+        done
+    done
+    for ((i = 0; i < w; i++)); do
+        names+=("n0_$i.inc")
+    done
+    put_file main.asm "${names[@]}"
+    ;;
+data)
+    line=$'\tdb'
+    for ((i = 0; i < 16; i++)); do
+        line+=" $((i * 15)),"
+    done
+    line+=$' 255\n'
+    block=''
+    for ((i = 0; i < 64; i++)); do
+        block+="$line"
+    done
+    # 64 KiB of data lines
+    : > data.tmp
+    while [[ $(stat -c %s data.tmp) -lt 65536 ]]; do
+        printf '%s' "$block" >> data.tmp
+    done
+    for ((i = 0; i < size; i++)); do
+        cp data.tmp "data$i.inc"
+        names+=("data$i.inc")
+    done
+    rm data.tmp
+    put_file main.asm "${names[@]}"
+    ;;
+incdirs)
+    for ((d = 0; d < 32; d++)); do
+        mkdir "i$d"
+        args+="-I i$d "
+    done
+    for ((i = 0; i < size; i++)); do
+        put_file "i31/f$i.inc"
+        names+=("f$i.inc")
+    done
+    put_file main.asm "${names[@]}"
+    ;;
+*)
+    echo "Unknown shape '$shape'." >&2
+    exit 1
+    ;;
+esac
+
+echo "${args}main.asm" > args
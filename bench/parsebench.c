@@ -0,0 +1,247 @@
+/* parsebench.c - microbenchmark of source line parsers.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+// Usage: parsebench [milliseconds]
+// Feeds line mixes to every "get_include_proc_t" of "parser.c" for about the
+// given time (200 ms by default) each and prints ns/line and lines/s.
+// Built by "src/Makefile" with the flags of aspp itself ("make parsebench").
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "parser.h"
+
+#define LINES_COUNT 4096        // lines in a mix
+#define LONG_SIZE   4000        // characters in a very long line
+
+struct line_t
+{
+    const char *s;
+    unsigned len;
+};
+
+// Line kinds
+
+const char *blank_lines[] =
+{
+    "", "\t", "    ", NULL
+};
+
+const char *comment_lines[] =
+{
+    "; load the next frame",
+    "\t; include nothing here",
+    "; ----------------------------------------------------------------",
+    NULL
+};
+
+const char *label_lines[] =
+{
+    "loop:", "draw_sprite", ".next", "include_end:", NULL
+};
+
+const char *opcode_lines[] =
+{
+    "\tld a,(hl)",
+    "\tinc hl",
+    "\tdjnz loop",
+    "\tjp nz,draw_sprite",
+    "\tdb \"Hello, world!\",0",
+    "\tinc de",
+    "include_size equ 100",
+    "\tincbin_size equ 200",
+    NULL
+};
+
+const char *directive_lines[] =
+{
+    "\tinclude \"gfx/sprites.inc\"",
+    "\tINCLUDE \"sound.asm\"",
+    "\tincbin \"data/level1.bin\"",
+    "include \"macros.inc\"",
+    "  include  \"lib/math/div16.asm\" ; comment",
+    NULL
+};
+
+// Mixes (a kind is repeated to get its share of lines)
+
+const struct
+{
+    const char *name;
+    const char **kinds[20];
+}
+mixes[] =
+{
+    { "blank", { blank_lines } },
+    { "comment", { comment_lines } },
+    { "label", { label_lines } },
+    { "opcode", { opcode_lines } },
+    { "directive", { directive_lines } },
+    { "long", { NULL } },               // made by "make_long_lines"
+    {
+        "mixed",                        // a typical source file
+        {
+            blank_lines, blank_lines, blank_lines,
+            comment_lines, comment_lines, comment_lines, comment_lines,
+            label_lines, label_lines,
+            opcode_lines, opcode_lines, opcode_lines, opcode_lines, opcode_lines,
+            opcode_lines, opcode_lines, opcode_lines, opcode_lines, opcode_lines,
+            directive_lines
+        }
+    },
+    { NULL, { NULL } }
+};
+
+const struct
+{
+    const char *name;
+    get_include_proc_t *proc;
+}
+procs[] =
+{
+    { "tasm", get_include_tasm },
+    { "sjasm", get_include_sjasm },
+    { NULL, NULL }
+};
+
+struct line_t lines[LINES_COUNT];
+char *long_data;
+volatile unsigned long long sink;       // results are used, so parsing is never optimized out
+
+long long now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Returns number of lines made.
+unsigned make_lines (unsigned mix)
+{
+    unsigned i, k, n[20];
+
+    memset (n, 0, sizeof (n));
+    for (i = 0, k = 0; i < LINES_COUNT; i++, k++)
+    {
+        if (k == sizeof (mixes[mix].kinds) / sizeof (mixes[mix].kinds[0]) || !mixes[mix].kinds[k])
+            k = 0;
+        if (!mixes[mix].kinds[k][n[k]])
+            n[k] = 0;
+        lines[i].s = mixes[mix].kinds[k][n[k]++];
+        lines[i].len = strlen (lines[i].s);
+    }
+    return LINES_COUNT;
+}
+
+// Returns number of lines made or 0 on fail.
+// Very long lines: data, comment and directive with a long file name.
+unsigned make_long_lines (void)
+{
+    const unsigned count = 256;
+    char *p;
+    unsigned i, j;
+
+    long_data = malloc ((size_t) count * (LONG_SIZE + 1));
+    if (!long_data)
+    {
+        perror ("malloc");
+        return 0;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        p = long_data + (size_t) i * (LONG_SIZE + 1);
+        switch (i % 3)
+        {
+        case 0:
+            strcpy (p, "\tdb ");
+            for (j = strlen (p); j + 2 < LONG_SIZE; j += 2)
+                strcpy (p + j, "0,");
+            strcpy (p + j, "0");
+            break;
+        case 1:
+            memset (p, 'x', LONG_SIZE);
+            memcpy (p, "; include", 9);
+            p[LONG_SIZE] = '\0';
+            break;
+        default:
+            memset (p, 'a', LONG_SIZE);
+            memcpy (p, "\tinclude \"", 10);
+            p[LONG_SIZE - 1] = '"';
+            p[LONG_SIZE] = '\0';
+            break;
+        }
+        lines[i].s = p;
+        lines[i].len = strlen (p);
+    }
+    return count;
+}
+
+int main (int argc, char **argv)
+{
+    unsigned m, p, i, count, flags, name_len, hits;
+    unsigned long long bytes, done;
+    long long limit, start, elapsed;
+    const char *name;
+    char *endp;
+
+    limit = 200;
+    if (argc > 1)
+    {
+        limit = strtol (argv[1], &endp, 10);
+        if (endp == argv[1] || *endp != '\0' || limit <= 0)
+        {
+            fprintf (stderr, "Usage: %s [milliseconds]" NL, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    limit *= 1000000LL;
+
+    printf ("%-6s %-10s %6s %9s %6s %9s %11s" NL,
+        "syntax", "mix", "lines", "bytes", "hits", "ns/line", "lines/s");
+
+    for (m = 0; mixes[m].name; m++)
+    {
+        count = mixes[m].kinds[0] ? make_lines (m) : make_long_lines ();
+        if (!count)
+            return EXIT_FAILURE;
+        bytes = 0;
+        for (i = 0; i < count; i++)
+            bytes += lines[i].len;
+
+        for (p = 0; procs[p].name; p++)
+        {
+            hits = 0;
+            for (i = 0; i < count; i++)
+                if (procs[p].proc (lines[i].s, lines[i].len, &flags, &name, &name_len) == PARST_OK)
+                    hits++;
+
+            done = 0;
+            start = now ();
+            do
+            {
+                for (i = 0; i < count; i++)
+                    if (procs[p].proc (lines[i].s, lines[i].len, &flags, &name, &name_len) == PARST_OK)
+                        sink += name_len + flags;
+                done += count;
+                elapsed = now () - start;
+            }
+            while (elapsed < limit);
+
+            printf ("%-6s %-10s %6u %9llu %6u %9.2f %11.0f" NL,
+                procs[p].name, mixes[m].name, count, bytes, hits,
+                (double) elapsed / done, done * 1e9 / elapsed);
+        }
+    }
+
+    free (long_data);
+
+    return EXIT_SUCCESS;
+}
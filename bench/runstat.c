@@ -0,0 +1,60 @@
+/* runstat.c - runs a command and reports its wall time and peak memory.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+// Usage: runstat <command> [argument ...]
+// Prints "<wall time in ns> <peak RSS in KiB> <exit status>" to stdout.
+// Output of the command is kept as is.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+int main (int argc, char **argv)
+{
+    struct timespec start, end;
+    struct rusage ru;
+    pid_t pid;
+    int status;
+
+    if (argc < 2)
+    {
+        fprintf (stderr, "Usage: %s <command> [argument ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    pid = fork ();
+    if (pid < 0)
+    {
+        perror ("fork");
+        return EXIT_FAILURE;
+    }
+    if (!pid)
+    {
+        execvp (argv[1], argv + 1);
+        perror ("execvp");
+        _exit (127);
+    }
+
+    if (wait4 (pid, &status, 0, &ru) < 0)
+    {
+        perror ("wait4");
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    printf ("%lld %ld %d\n",
+        (long long) (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec),
+        ru.ru_maxrss,
+        WIFEXITED (status) ? WEXITSTATUS (status) : 128 + WTERMSIG (status));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#!/bin/bash
+#
+# stress.sh - aspp scalability test on synthetic assembler sources.
+#
+# This is free and unencumbered software released into the public domain.
+# For more information, please refer to <http://unlicense.org>.
+#
+# Usage:
+#     stress.sh <aspp> <runstat> <work directory> [base [steps [runs [tolerance]]]]
+#
+# Scales the number of files ("tree" shape, see "gen.sh"), the number of
+# included files per file ("fanout" and "incdirs") and the nesting depth
+# ("deep") by 10 times in every step starting from "base" (100 by default),
+# 3 steps by default. The best of several runs (3 by default) is taken.
+# Fails when time grows more than "tolerance" percents (200 by default) of
+# 10 times between two steps.
+#
+set -e
+
+if [[ $# -lt 3 ]]; then
+    echo "Usage: $0 <aspp> <runstat> <work directory> [base [steps [runs [tolerance]]]]" >&2
+    exit 1
+fi
+
+aspp=$(realpath "$1")
+runstat=$(realpath "$2")
+work="$3"
+declare -i base="${4:-100}"
+declare -i steps="${5:-3}"
+declare -i runs="${6:-3}"
+declare -i tolerance="${7:-200}"
+gen="$(dirname "$(realpath "$0")")/gen.sh"
+
+shapes='tree fanout incdirs deep'
+syntax='tasm'
+
+if [[ $base -lt 1 || $steps -lt 2 || $runs -lt 1 || $tolerance -lt 100 ]]; then
+    echo "Bad parameters." >&2
+    exit 1
+fi
+
+mkdir -p "$work"
+
+declare -i failed=0
+
+printf '%-8s %7s %10s %9s  %s\n' shape size 'time, us' 'growth' result
+
+for shape in $shapes; do
+    declare -i size=$base last=0
+    for ((s = 0; s < steps; s++, size *= 10)); do
+        dir="$work/$shape"
+        bash "$gen" "$dir" "$syntax" "$shape" "$size"
+        read -r args < "$dir/args"
+        declare -i best=0
+        for ((r = 0; r < runs; r++)); do
+            # Word splitting of "args" is intended
+            # shellcheck disable=SC2086
+            read -r t m st < <(cd "$dir" && "$runstat" "$aspp" --syntax "$syntax" \
+                -E -M -MF out.d -MT main.o $args)
+            if [[ $st -ne 0 ]]; then
+                echo "aspp failed (status $st) on '$dir'." >&2
+                exit 1
+            fi
+            if [[ $best -eq 0 || $t -lt $best ]]; then
+                best=$t
+            fi
+        done
+        if [[ $best -lt 1 ]]; then
+            best=1
+        fi
+        if [[ $last -eq 0 ]]; then
+            printf '%-8s %7u %10u %9s  %s\n' "$shape" "$size" "$((best / 1000))" '' ''
+        else
+            # Growth of time for 10 times more input, in percents of 10 times
+            declare -i growth=$((best * 10 / last))
+            if [[ $growth -gt $tolerance ]]; then
+                result='FAILED (super-linear)'
+                failed=1
+            else
+                result='ok'
+            fi
+            printf '%-8s %7u %10u %8u%%  %s\n' "$shape" "$size" "$((best / 1000))" "$growth" "$result"
+        fi
+        last=$best
+    done
+done
+
+if [[ $failed -ne 0 ]]; then
+    echo "Time grows super-linearly (tolerance is $tolerance%)." >&2
+    exit 1
+fi
@@ -0,0 +1,145 @@
+/* arena.c - arena (bump) allocator structure.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "stats.h"
+#include "arena.h"
+
+// Chunks grow twice each time from the minimal size up to the maximal one
+#define ARENA_CHUNK_MIN 512
+#define ARENA_CHUNK_MAX (64 * 1024)
+
+#define ARENA_ALIGN _Alignof (max_align_t)
+
+struct arena_chunk_t
+{
+    struct arena_chunk_t *next;
+    max_align_t data[];
+};
+
+void
+    arena_clear
+    (
+        struct arena_t *self
+    )
+{
+    self->chunks = (struct arena_chunk_t *) NULL;
+    self->pos = (char *) NULL;
+    self->end = (char *) NULL;
+    self->next_size = ARENA_CHUNK_MIN;
+}
+
+// Returns pointer on success and "NULL" on fail.
+void *
+    _arena_get
+    (
+        struct arena_t *self,
+        size_t size,
+        size_t align
+    )
+{
+    struct arena_chunk_t *c;
+    size_t n;
+    char *p;
+
+    if (self->pos)
+    {
+        p = (char *) (((size_t) self->pos + align - 1) & ~(align - 1));
+        if (p <= self->end && size <= (size_t) (self->end - p))
+        {
+            self->pos = p + size;
+            stats_add (STAT_ALLOCATIONS, 1);
+            return p;
+        }
+    }
+
+    // Get a new chunk (big requests get a chunk of their own)
+    if (!self->next_size)
+        self->next_size = ARENA_CHUNK_MIN;
+    n = size > self->next_size ? size : self->next_size;
+    c = malloc (offsetof (struct arena_chunk_t, data) + n);
+    if (!c)
+    {
+        _perror ("malloc");
+        return NULL;
+    }
+    c->next = self->chunks;
+    self->chunks = c;
+    stats_add (STAT_ALLOCATIONS, 1);
+    stats_add (STAT_CHUNKS, 1);
+    if (n == self->next_size && self->next_size < ARENA_CHUNK_MAX)
+        self->next_size *= 2;
+
+    p = (char *) c->data;
+    if (!self->pos || n - size >= (size_t) (self->end - self->pos))
+    {
+        // Continue in the new chunk if it has more free space left
+        self->pos = p + size;
+        self->end = p + n;
+    }
+    return p;
+}
+
+void *
+    arena_alloc
+    (
+        struct arena_t *self,
+        size_t size
+    )
+{
+    return _arena_get (self, size, ARENA_ALIGN);
+}
+
+char *
+    arena_strndup
+    (
+        struct arena_t *self,
+        const char *s,
+        size_t len
+    )
+{
+    char *p;
+
+    p = _arena_get (self, len + 1, 1);  // including terminating zero
+    if (p)
+    {
+        memcpy (p, s, len);
+        p[len] = '\0';
+    }
+    return p;
+}
+
+char *
+    arena_strdup
+    (
+        struct arena_t *self,
+        const char *s
+    )
+{
+    return arena_strndup (self, s, strlen (s));
+}
+
+void
+    arena_free
+    (
+        struct arena_t *self
+    )
+{
+    struct arena_chunk_t *c, *n;
+
+    c = self->chunks;
+    while (c)
+    {
+        n = c->next;
+        free (c);
+        c = n;
+    }
+    arena_clear (self);
+}
@@ -0,0 +1,66 @@
+/* arena.h - declarations for "arena.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _ARENA_H_INCLUDED
+#define _ARENA_H_INCLUDED
+
+#include "defs.h"
+
+#include <stddef.h>
+
+// Arena (bump) allocator structure
+// Memory is taken from large chunks and is released all at once.
+
+struct arena_chunk_t;
+
+struct arena_t
+{
+    struct arena_chunk_t *chunks;
+    char *pos;          // free space in the last chunk
+    char *end;
+    size_t next_size;   // size of the next chunk to allocate
+};
+
+void
+    arena_clear
+    (
+        struct arena_t *self
+    );
+
+// Returns pointer on success and "NULL" on fail.
+// Result is suitably aligned for any type.
+void *
+    arena_alloc
+    (
+        struct arena_t *self,
+        size_t size
+    );
+
+// Returns string on success and "NULL" on fail.
+// "s" of "len" characters is not required to be zero-terminated.
+char *
+    arena_strndup
+    (
+        struct arena_t *self,
+        const char *s,
+        size_t len
+    );
+
+// Returns string on success and "NULL" on fail.
+char *
+    arena_strdup
+    (
+        struct arena_t *self,
+        const char *s
+    );
+
+// Releases all memory taken from arena.
+void
+    arena_free
+    (
+        struct arena_t *self
+    );
+
+#endif  // !_ARENA_H_INCLUDED
@@ -10,16 +10,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+#endif
 #include "debug.h"
 #include "l_list.h"
+#include "stats.h"
 #include "asmfile.h"
 
+// Files of this size and larger are mapped into memory instead of being read
+#define ASM_FILE_MAP_MIN (64 * 1024L)
+
 void _asm_file_reset_pos (struct asm_file_t *self)
 {
     self->pos = -1;             // invalid
     self->line = 0;             // invalid
+    self->line_pos = 0;
     self->line_start = -1;      // invalid
     self->line_end = -1;        // invalid
+    self->eol_base = -1;        // invalid
+    self->eol_mask = 0;
+    self->key_base = -1;        // invalid
+    self->key_mask = 0;
 }
 
 void asm_file_clear (struct asm_file_t *self)
@@ -28,10 +44,176 @@ void asm_file_clear (struct asm_file_t *self)
         return; // Fail
     self->data = NULL;
     self->size = 0;
+    self->mapped = false;
+    self->fd = -1;
     _asm_file_reset_pos (self);
 }
 
-// Returns "false" on success.
+#if !defined (_WIN32) && !defined(_WIN64)
+
+// Returns "true" on success.
+bool _asm_file_read (int fd, char *p, long size)
+{
+    ssize_t n;
+
+    while (size)
+    {
+        n = read (fd, p, size);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (!n)
+                errno = EIO;    // file was truncated
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Returns "true" on success.
+bool asm_file_load (struct asm_file_t *self, const char *name)
+{
+    bool ok;
+    int fd;
+    struct stat st;
+    long s;
+    char *p;
+    bool mapped;
+
+    if (!self)
+    {
+        // Fail
+        errno = EINVAL;
+        return false;
+    }
+
+    ok = false;
+    s = 0;
+    p = NULL;
+    mapped = false;
+
+    _DBG_ ("File name = '%s'", name);
+
+    fd = open (name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // Fail
+        _perror ("open");
+        goto _local_exit;
+    }
+
+    if (fstat (fd, &st) < 0)
+    {
+        // Fail
+        _perror ("fstat");
+        goto _local_exit;
+    }
+    s = st.st_size;
+
+    _DBG_ ("File size = %li", (long) s);
+
+    if (!s)
+    {
+        // Success (empty file)
+        ok = true;
+        goto _local_exit;
+    }
+
+    // Large files are mapped to avoid copying them, small ones are cheaper to read
+    if (s >= ASM_FILE_MAP_MIN)
+    {
+        p = mmap (NULL, s, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            madvise (p, s, MADV_SEQUENTIAL);
+            mapped = true;
+            // Success
+            ok = true;
+            goto _local_exit;
+        }
+        _perror ("mmap");
+        p = NULL;
+        // Fall back to reading
+    }
+
+    p = malloc (s);
+    if (!p)
+    {
+        // Fail
+        _perror ("malloc");
+        goto _local_exit;
+    }
+    if (!_asm_file_read (fd, p, s))
+    {
+        // Fail
+        _perror ("read");
+        goto _local_exit;
+    }
+    // Success
+    ok = true;
+
+_local_exit:
+    if (ok)
+    {
+        stats_add (STAT_FILES_LOADED, 1);
+        stats_add (STAT_BYTES_READ, s);
+    }
+    if (fd >= 0 && !mapped)
+    {
+        close (fd);
+        fd = -1;
+    }
+    if (!ok)
+    {
+        if (p)
+            free (p);
+        p = NULL;
+        s = 0;
+    }
+    self->data = p;
+    self->size = s;
+    self->mapped = mapped;
+    self->fd = fd;
+    _asm_file_reset_pos (self);
+    return ok;
+}
+
+bool asm_file_check (struct asm_file_t *self)
+{
+    struct stat st;
+
+    if (!self)
+    {
+        // Fail
+        errno = EINVAL;
+        return false;
+    }
+    if (!self->mapped)
+        return true;    // Success (data was copied)
+
+    if (fstat (self->fd, &st) < 0)
+    {
+        // Fail
+        _perror ("fstat");
+        return false;
+    }
+    if (st.st_size < self->size)
+    {
+        // Fail
+        _DBG_ ("File was truncated from %li to %li bytes.", self->size, (long) st.st_size);
+        errno = EIO;
+        return false;
+    }
+    // Success
+    return true;
+}
+
+#else   // defined (_WIN32) || defined(_WIN64)
+
+// Returns "true" on success.
 bool asm_file_load (struct asm_file_t *self, const char *name)
 {
     bool ok;
@@ -53,11 +235,7 @@ bool asm_file_load (struct asm_file_t *self, const char *name)
 
     _DBG_ ("File name = '%s'", name);
 
-#if defined (_WIN32) || defined (_WIN64)
     f = fopen (name, "rb");
-#else
-    f = fopen (name, "r");
-#endif
     if (!f)
     {
         // Fail
@@ -109,11 +287,16 @@ bool asm_file_load (struct asm_file_t *self, const char *name)
             _perror ("fread");
             goto _local_exit;
         }
-        // Success
-        ok = true;
     }
+    // Success (an empty file has no data)
+    ok = true;
 
 _local_exit:
+    if (ok)
+    {
+        stats_add (STAT_FILES_LOADED, 1);
+        stats_add (STAT_BYTES_READ, s);
+    }
     if (f)
         fclose (f);
     if (!ok)
@@ -125,10 +308,26 @@ _local_exit:
     }
     self->data = p;
     self->size = s;
+    self->mapped = false;
+    self->fd = -1;
     _asm_file_reset_pos (self);
     return ok;
 }
 
+bool asm_file_check (struct asm_file_t *self)
+{
+    if (!self)
+    {
+        // Fail
+        errno = EINVAL;
+        return false;
+    }
+    // Success (data is always copied)
+    return true;
+}
+
+#endif  // defined (_WIN32) || defined(_WIN64)
+
 bool asm_file_eof (struct asm_file_t *self)
 {
     if (!self)
@@ -175,18 +374,267 @@ bool asm_file_eol (struct asm_file_t *self)
         return true;    // Fail
 }
 
-const char *_find_line_end (const char *s, unsigned len)
+// Line ends search.
+// Bytes of data are checked by blocks of 64 and the positions of line end
+// characters of the current block are kept as a bit mask, so most lines
+// are found with a single bit scan.
+
+#define EOL_BLOCK 64
+
+typedef unsigned long long _eol_mask_proc_t (const char *s);
+
+unsigned long long _eol_mask_generic (const char *s)
 {
-    if (!s)
-        return (char *) NULL;   // Fail
-    while (len)
+    unsigned long long m;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i++)
+        if (s[i] == '\r' || s[i] == '\n')
+            m |= 1ULL << i;
+    return m;
+}
+
+// Key search.
+// Candidate positions of keys are found by blocks of 64 too: a bit is set
+// if both the first and the last characters of a key match (ignoring
+// case), the rest and the blanks around are checked for every candidate.
+// "first" and "last" are lower case letters, "dist" is the key length - 1.
+
+typedef unsigned long long _key_mask_proc_t (const char *s, char first, char last, unsigned dist);
+
+unsigned long long _key_mask_generic (const char *s, char first, char last, unsigned dist)
+{
+    unsigned long long m;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i++)
+        if ((s[i] | 0x20) == first && (s[i + dist] | 0x20) == last)
+            m |= 1ULL << i;
+    return m;
+}
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+
+#include <immintrin.h>
+
+__attribute__ ((target ("sse2")))
+unsigned long long _eol_mask_sse2 (const char *s)
+{
+    const __m128i cr = _mm_set1_epi8 ('\r');
+    const __m128i lf = _mm_set1_epi8 ('\n');
+    unsigned long long m;
+    __m128i v;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i += 16)
+    {
+        v = _mm_loadu_si128 ((const __m128i *) (s + i));
+        m |= (unsigned long long) (unsigned) _mm_movemask_epi8 (
+            _mm_or_si128 (_mm_cmpeq_epi8 (v, cr), _mm_cmpeq_epi8 (v, lf))) << i;
+    }
+    return m;
+}
+
+__attribute__ ((target ("avx2")))
+unsigned long long _eol_mask_avx2 (const char *s)
+{
+    const __m256i cr = _mm256_set1_epi8 ('\r');
+    const __m256i lf = _mm256_set1_epi8 ('\n');
+    unsigned long long m;
+    __m256i v;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i += 32)
+    {
+        v = _mm256_loadu_si256 ((const __m256i *) (s + i));
+        m |= (unsigned long long) (unsigned) _mm256_movemask_epi8 (
+            _mm256_or_si256 (_mm256_cmpeq_epi8 (v, cr), _mm256_cmpeq_epi8 (v, lf))) << i;
+    }
+    return m;
+}
+
+__attribute__ ((target ("sse2")))
+unsigned long long _key_mask_sse2 (const char *s, char first, char last, unsigned dist)
+{
+    const __m128i lc = _mm_set1_epi8 (0x20);
+    const __m128i f = _mm_set1_epi8 (first);
+    const __m128i l = _mm_set1_epi8 (last);
+    unsigned long long m;
+    __m128i a, b;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i += 16)
+    {
+        a = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (s + i)), lc);
+        b = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (s + i + dist)), lc);
+        m |= (unsigned long long) (unsigned) _mm_movemask_epi8 (
+            _mm_and_si128 (_mm_cmpeq_epi8 (a, f), _mm_cmpeq_epi8 (b, l))) << i;
+    }
+    return m;
+}
+
+__attribute__ ((target ("avx2")))
+unsigned long long _key_mask_avx2 (const char *s, char first, char last, unsigned dist)
+{
+    const __m256i lc = _mm256_set1_epi8 (0x20);
+    const __m256i f = _mm256_set1_epi8 (first);
+    const __m256i l = _mm256_set1_epi8 (last);
+    unsigned long long m;
+    __m256i a, b;
+    unsigned i;
+
+    m = 0;
+    for (i = 0; i < EOL_BLOCK; i += 32)
+    {
+        a = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (s + i)), lc);
+        b = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (s + i + dist)), lc);
+        m |= (unsigned long long) (unsigned) _mm256_movemask_epi8 (
+            _mm256_and_si256 (_mm256_cmpeq_epi8 (a, f), _mm256_cmpeq_epi8 (b, l))) << i;
+    }
+    return m;
+}
+
+_eol_mask_proc_t *_eol_mask = _eol_mask_generic;
+_key_mask_proc_t *_key_mask = _key_mask_generic;
+
+// Selects the best implementation at program start, before any thread
+// (scanning files) is started.
+__attribute__ ((constructor))
+void _asm_file_select_simd (void)
+{
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+    {
+        _eol_mask = _eol_mask_avx2;
+        _key_mask = _key_mask_avx2;
+    }
+    else if (__builtin_cpu_supports ("sse2"))
+    {
+        _eol_mask = _eol_mask_sse2;
+        _key_mask = _key_mask_sse2;
+    }
+    else
+    {
+        _eol_mask = _eol_mask_generic;
+        _key_mask = _key_mask_generic;
+    }
+}
+
+#else   // !(defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__)))
+
+_eol_mask_proc_t *_eol_mask = _eol_mask_generic;
+_key_mask_proc_t *_key_mask = _key_mask_generic;
+
+#endif  // !(defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__)))
+
+// Returns position of the first line end character at "pos" or after it
+// (or the size of data if there is none).
+long _asm_file_find_line_end (struct asm_file_t *self, long pos)
+{
+    unsigned long long m;
+    long i;
+
+    while (pos < self->size)
+    {
+        if (self->eol_base < 0 || pos < self->eol_base || pos >= self->eol_base + EOL_BLOCK)
+        {
+            self->eol_base = pos - pos % EOL_BLOCK;
+            if (self->eol_base + EOL_BLOCK <= self->size)
+                self->eol_mask = _eol_mask (self->data + self->eol_base);
+            else
+            {
+                // Last block is incomplete
+                self->eol_mask = 0;
+                for (i = self->eol_base; i < self->size; i++)
+                    if (self->data[i] == '\r' || self->data[i] == '\n')
+                        self->eol_mask |= 1ULL << (i - self->eol_base);
+            }
+        }
+        m = self->eol_mask & (~0ULL << (pos - self->eol_base));
+        if (m)
+            return self->eol_base + __builtin_ctzll (m);
+        pos = self->eol_base + EOL_BLOCK;
+    }
+    return self->size;
+}
+
+// Returns "true" if one of "keys" is at "p" ignoring case, preceded by a
+// blank or a line start and followed by a blank.
+static inline __attribute__ ((always_inline))
+bool _asm_file_is_key (struct asm_file_t *self, long p, const char *const *keys)
+{
+    const char *const *k;
+    long i;
+    char c;
+
+    if (p)
+    {
+        c = self->data[p - 1];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+            return false;
+    }
+    for (k = keys; *k; k++)
+    {
+        for (i = 0; (*k)[i] && p + i < self->size; i++)
+            if ((self->data[p + i] | 0x20) != (*k)[i])
+                break;
+        if (!(*k)[i] && p + i < self->size && (self->data[p + i] == ' ' || self->data[p + i] == '\t'))
+            return true;
+    }
+    return false;
+}
+
+// Returns position of the first occurrence of one of "keys" (NULL-terminated
+// list of lower case words) at "pos" or after it ignoring case (or the size
+// of data if there is none). See "_asm_file_is_key".
+long _asm_file_find_key (struct asm_file_t *self, long pos, const char *const *keys)
+{
+    const char *const *k;
+    unsigned long long m;
+    unsigned dist, d;
+    long p;
+
+    dist = 0;   // of the longest key
+    for (k = keys; *k; k++)
+        if (dist < strlen (*k) - 1)
+            dist = strlen (*k) - 1;
+
+    while (pos < self->size)
     {
-        if (len && (*s == '\r' || *s == '\n'))
-            break;
-        s++;
-        len--;
+        if (self->key_base < 0 || pos < self->key_base || pos >= self->key_base + EOL_BLOCK)
+        {
+            self->key_base = pos - pos % EOL_BLOCK;
+            self->key_mask = 0;
+            for (k = keys; *k; k++)
+            {
+                d = strlen (*k) - 1;
+                if (self->key_base + EOL_BLOCK + dist <= self->size)
+                    self->key_mask |= _key_mask (self->data + self->key_base, (*k)[0], (*k)[d], d);
+                else
+                {
+                    // Last block is incomplete
+                    for (p = self->key_base; p < self->key_base + EOL_BLOCK && p + d < self->size; p++)
+                        if ((self->data[p] | 0x20) == (*k)[0] && (self->data[p + d] | 0x20) == (*k)[d])
+                            self->key_mask |= 1ULL << (p - self->key_base);
+                }
+            }
+        }
+        m = self->key_mask & (~0ULL << (pos - self->key_base));
+        while (m)
+        {
+            p = self->key_base + __builtin_ctzll (m);
+            if (_asm_file_is_key (self, p, keys))
+                return p;       // found
+            m &= m - 1;
+        }
+        pos = self->key_base + EOL_BLOCK;
     }
-    return s;   // Success
+    return self->size;
 }
 
 const char *_skip_line_end (const char *s, unsigned len)
@@ -219,8 +667,8 @@ const char *_skip_line_end (const char *s, unsigned len)
 
 bool asm_file_next_line (struct asm_file_t *self, const char **s, unsigned *len)
 {
-    const char *startp, *endp;
-    unsigned sz;
+    const char *startp;
+    long endp;
 
     if (!self || !s || !len)
     {
@@ -233,25 +681,22 @@ bool asm_file_next_line (struct asm_file_t *self, const char **s, unsigned *len)
         if (self->pos < 0)
         {
             // Start reading
-            sz = self->size;
             startp = self->data;
+            self->line = 1;
+            self->line_pos = 0;
         }
         else
         {
             // Continue reading
-            sz = self->size - self->line_end;
-            startp = _skip_line_end (self->data + self->line_end, sz);
-            self->pos = startp - self->data;
-            sz = self->size - self->pos;
+            startp = _skip_line_end (self->data + self->line_end, self->size - self->line_end);
         }
-        endp = _find_line_end (startp, sz);
         self->pos = startp - self->data;
         if (!asm_file_eof (self))
         {
             // Success
-            self->line++;
+            endp = _asm_file_find_line_end (self, self->pos);
             self->line_start = self->pos;
-            self->line_end = endp - self->data;
+            self->line_end = endp;
             *s = self->data + self->line_start;
             *len = self->line_end - self->line_start;
             return true;
@@ -265,6 +710,87 @@ bool asm_file_next_line (struct asm_file_t *self, const char **s, unsigned *len)
     return false;
 }
 
+bool asm_file_next_line_with (struct asm_file_t *self, const char *const *keys, const char **s, unsigned *len)
+{
+    long startp, found, endp;
+
+    if (!self || !keys || !*keys || !s || !len)
+    {
+        // Fail
+        errno = EINVAL;
+        return false;
+    }
+    if (self->pos < 0 || (self->pos >= 0 && !asm_file_eof (self)))
+    {
+        if (self->pos < 0)
+        {
+            // Start reading
+            startp = 0;
+            self->line = 1;
+            self->line_pos = 0;
+        }
+        else
+        {
+            // Continue reading
+            startp = _skip_line_end (self->data + self->line_end, self->size - self->line_end) - self->data;
+        }
+        found = _asm_file_find_key (self, startp, keys);
+        if (found < self->size)
+        {
+            // Success
+            // Every line starts right after a line end character
+            for (self->pos = found; self->pos > startp; self->pos--)
+                if (self->data[self->pos - 1] == '\r' || self->data[self->pos - 1] == '\n')
+                    break;
+            endp = _asm_file_find_line_end (self, found);
+            self->line_start = self->pos;
+            self->line_end = endp;
+            *s = self->data + self->line_start;
+            *len = self->line_end - self->line_start;
+            return true;
+        }
+        self->pos = self->size;
+    }
+    // Fail
+    self->line_start = self->pos;
+    self->line_end = self->pos;
+    *s = (char *) NULL;
+    *len = 0;
+    return false;
+}
+
+long asm_file_line (struct asm_file_t *self)
+{
+    long endp;
+
+    if (!self || self->line_start < 0)
+        return 0;       // Fail
+
+    // Count lines skipped since last call
+    while (self->line_pos < self->line_start)
+    {
+        endp = _asm_file_find_line_end (self, self->line_pos);
+        self->line_pos = _skip_line_end (self->data + endp, self->size - endp) - self->data;
+        self->line++;
+    }
+    return self->line;
+}
+
+long asm_file_count_lines (struct asm_file_t *self)
+{
+    long pos, n;
+
+    if (!self)
+        return 0;       // Fail
+
+    for (n = 0, pos = 0; pos < self->size; n++)
+    {
+        pos = _asm_file_find_line_end (self, pos);
+        pos = _skip_line_end (self->data + pos, self->size - pos) - self->data;
+    }
+    return n;
+}
+
 void asm_file_free (struct asm_file_t *self)
 {
     if (!self)
@@ -274,6 +800,16 @@ void asm_file_free (struct asm_file_t *self)
         return;
     }
     if (self->data)
-        free (self->data);
+    {
+#if !defined (_WIN32) && !defined(_WIN64)
+        if (self->mapped)
+        {
+            munmap (self->data, self->size);
+            close (self->fd);
+        }
+        else
+#endif
+            free (self->data);
+    }
     asm_file_clear (self);
 }
@@ -17,10 +17,17 @@ struct asm_file_t
 {
     char *data;
     long size;
+    bool mapped;        // "data" is mapped into memory (not allocated)
+    int fd;             // file descriptor kept open while "data" is mapped
     long pos;
-    long line;
+    long line;          // number of the line starting at "line_pos"
+    long line_pos;
     long line_start;
     long line_end;
+    long eol_base;      // start of the block described by "eol_mask"
+    unsigned long long eol_mask;        // line end characters in the block
+    long key_base;      // start of the block described by "key_mask"
+    unsigned long long key_mask;        // key candidates in the block
 };
 
 void asm_file_clear (struct asm_file_t *self);
@@ -28,6 +35,11 @@ void asm_file_clear (struct asm_file_t *self);
 // Returns "true" on success.
 bool asm_file_load (struct asm_file_t *self, const char *name);
 
+// Returns "true" if file was not truncated since it was loaded.
+// Mapped data can not be read past the new end of file (SIGBUS is raised), so
+// a file shrunk during scanning must be reported to discard the results.
+bool asm_file_check (struct asm_file_t *self);
+
 // Returns "true" on success.
 bool asm_file_eof (struct asm_file_t *self);
 
@@ -37,6 +49,20 @@ bool asm_file_eol (struct asm_file_t *self);
 // Returns "true" on success.
 bool asm_file_next_line (struct asm_file_t *self, const char **s, unsigned *len);
 
+// Returns "true" on success.
+// Same as "asm_file_next_line" but skips lines not containing any of "keys"
+// (NULL-terminated list of lower case words, case is ignored) preceded by a
+// blank or a line start and followed by a blank. The whole data is searched
+// for the keys, so lines without them are never split.
+bool asm_file_next_line_with (struct asm_file_t *self, const char *const *keys, const char **s, unsigned *len);
+
+// Returns number of lines in data (the last one may have no line end).
+// The whole data is walked through - meant for statistics only.
+long asm_file_count_lines (struct asm_file_t *self);
+
+// Returns number of the current line (counted on demand) or 0 on fail.
+long asm_file_line (struct asm_file_t *self);
+
 void asm_file_free (struct asm_file_t *self);
 
 #endif  // !_ASMFILE_H_INCLUDED
@@ -0,0 +1,262 @@
+/* dircache.c - directory listings cache.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <dirent.h>
+# include <pthread.h>
+#endif
+#include "debug.h"
+#include "arena.h"
+#include "intern.h"
+#include "l_hash.h"
+#include "platform.h"
+#include "dircache.h"
+
+#if !defined (_WIN32) && !defined(_WIN64) && defined (_DIRENT_HAVE_D_TYPE)
+
+struct dir_cache_dir_t;
+
+struct dir_cache_entry_t
+{
+    struct hash_entry_t hash_entry;     // indexed by "name"
+    const char *name;   // interned
+    unsigned char type; // "d_type" of "struct dirent"
+    struct dir_cache_dir_t *sub;        // listing of a subdirectory (if loaded)
+};
+
+struct dir_cache_dir_t
+{
+    struct hash_entry_t hash_entry;     // indexed by "real"
+    const char *real;   // interned
+    bool listed;        // "false" if directory could not be read
+    struct hash_t entries;      // not changed once added to cache
+    struct arena_t arena;       // entries
+};
+
+struct arena_t _dir_cache_arena;
+struct hash_t _dir_cache_dirs;
+
+// Listings are looked into by worker threads too (directories are read
+// unlocked, the first listing added to cache is kept)
+pthread_mutex_t _dir_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Returns "false" on success.
+// Called unlocked: "self" is not in cache yet.
+bool _dir_cache_read (struct dir_cache_dir_t *self)
+{
+    DIR *d;
+    struct dirent *de;
+    struct dir_cache_entry_t *p;
+
+    d = opendir (self->real);
+    if (!d)
+    {
+        _perror ("opendir");
+        return true;
+    }
+
+    while ((de = readdir (d)) != NULL)
+    {
+        if (!strcmp (de->d_name, ".") || !strcmp (de->d_name, ".."))
+            continue;
+        p = arena_alloc (&self->arena, sizeof (struct dir_cache_entry_t));
+        if (!p)
+        {
+            _perror ("arena_alloc");
+            goto _fail;
+        }
+        hash_entry_clear (&p->hash_entry);
+        p->name = intern_str (de->d_name);
+        if (!p->name)
+        {
+            _perror ("intern_str");
+            goto _fail;
+        }
+        p->type = de->d_type;
+        p->sub = (struct dir_cache_dir_t *) NULL;
+        if (hash_add_entry (&self->entries, &p->hash_entry, intern_hash (p->name)))
+        {
+            _perror ("hash_add_entry");
+            goto _fail;
+        }
+    }
+
+    closedir (d);
+    _DBG_ ("Read %u entries of directory '%s'.", self->entries.count, self->real);
+    return false;
+
+_fail:
+    closedir (d);
+    return true;
+}
+
+// Must be called locked.
+struct dir_cache_dir_t *_dir_cache_lookup (const char *real)
+{
+    struct hash_entry_t *h;
+    struct dir_cache_dir_t *p;
+
+    for (h = hash_first (&_dir_cache_dirs, intern_hash (real)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct dir_cache_dir_t, hash_entry);
+        if (p->real == real)
+            return p;
+    }
+    return NULL;
+}
+
+// Returns directory listing on success and "NULL" on fail.
+struct dir_cache_dir_t *_dir_cache_get (const char *real)
+{
+    struct dir_cache_dir_t *p;
+    struct dir_cache_dir_t dir;
+    bool added;
+
+    real = intern_str (real);
+    if (!real)
+    {
+        _perror ("intern_str");
+        return NULL;
+    }
+
+    pthread_mutex_lock (&_dir_cache_mutex);
+    p = _dir_cache_lookup (real);
+    pthread_mutex_unlock (&_dir_cache_mutex);
+    if (p)
+        return p;       // Success (cached)
+
+    hash_entry_clear (&dir.hash_entry);
+    dir.real = real;
+    hash_clear (&dir.entries);
+    arena_clear (&dir.arena);
+    dir.listed = !_dir_cache_read (&dir);
+
+    added = false;
+    pthread_mutex_lock (&_dir_cache_mutex);
+    p = _dir_cache_lookup (real);       // may be added by another thread meanwhile
+    if (!p)
+    {
+        p = arena_alloc (&_dir_cache_arena, sizeof (struct dir_cache_dir_t));
+        if (!p)
+            _perror ("arena_alloc");
+        else
+        {
+            *p = dir;
+            if (hash_add_entry (&_dir_cache_dirs, &p->hash_entry, intern_hash (real)))
+            {
+                _perror ("hash_add_entry");
+                p = NULL;       // left in arena
+            }
+            else
+                added = true;
+        }
+    }
+    pthread_mutex_unlock (&_dir_cache_mutex);
+
+    // The first listing is kept
+    if (!added)
+    {
+        hash_free (&dir.entries);
+        arena_free (&dir.arena);
+    }
+
+    return p;
+}
+
+// Returns entry of a listed directory "dir" or "NULL" if there is none.
+// Called unlocked: entries are not changed once listing is in cache.
+struct dir_cache_entry_t *_dir_cache_find (struct dir_cache_dir_t *dir, const char *name, unsigned len)
+{
+    struct hash_entry_t *h;
+    struct dir_cache_entry_t *p;
+
+    // Every listed name is interned
+    name = intern_lookup_n (name, len);
+    if (!name)
+        return NULL;
+
+    for (h = hash_first (&dir->entries, intern_hash (name)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct dir_cache_entry_t, hash_entry);
+        if (p->name == name)
+            return p;
+    }
+    return NULL;
+}
+
+unsigned dir_cache_find_file (const char *dir, const char *name)
+{
+    struct dir_cache_dir_t *d, *sub;
+    struct dir_cache_entry_t *p;
+    const char *s, *e;
+    char path[PATH_MAX];
+
+    if (!dir || !name)
+        return DIR_CACHE_UNKNOWN;
+
+    d = _dir_cache_get (dir);
+    for (s = name;;)
+    {
+        if (!d || !d->listed)
+            return DIR_CACHE_UNKNOWN;
+
+        e = s;
+        while (*e != '\0' && *e != '/' && *e != '\\')
+            e++;
+        // Special names are left to system
+        if (e == s
+        ||  (e - s == 1 && s[0] == '.')
+        ||  (e - s == 2 && s[0] == '.' && s[1] == '.'))
+            return DIR_CACHE_UNKNOWN;
+
+        p = _dir_cache_find (d, s, e - s);
+        if (!p)
+            return DIR_CACHE_MISSING;
+        if (p->type == DT_LNK || p->type == DT_UNKNOWN)
+            return DIR_CACHE_UNKNOWN;   // needs "stat"
+
+        if (*e == '\0')
+            return p->type == DT_REG ? DIR_CACHE_FILE : DIR_CACHE_MISSING;
+
+        if (p->type != DT_DIR)
+            return DIR_CACHE_MISSING;   // not a directory
+
+        // Subdirectories are read on demand
+        pthread_mutex_lock (&_dir_cache_mutex);
+        sub = p->sub;
+        pthread_mutex_unlock (&_dir_cache_mutex);
+        if (!sub)
+        {
+            if (snprintf (path, sizeof (path), "%s" PATHSEPSTR "%s", d->real, p->name) >= (int) sizeof (path))
+                return DIR_CACHE_UNKNOWN;
+            sub = _dir_cache_get (path);
+            if (sub)
+            {
+                pthread_mutex_lock (&_dir_cache_mutex);
+                p->sub = sub;   // same listing from any thread
+                pthread_mutex_unlock (&_dir_cache_mutex);
+            }
+        }
+        d = sub;
+        s = e + 1;
+    }
+}
+
+#else   // defined (_WIN32) || defined(_WIN64) || !defined (_DIRENT_HAVE_D_TYPE)
+
+// File types are not listed (or names are not case-sensitive) - always ask system.
+
+unsigned dir_cache_find_file (const char *dir, const char *name)
+{
+    return DIR_CACHE_UNKNOWN;
+}
+
+#endif  // defined (_WIN32) || defined(_WIN64) || !defined (_DIRENT_HAVE_D_TYPE)
@@ -0,0 +1,23 @@
+/* dircache.h - declarations for "dircache.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _DIRCACHE_H_INCLUDED
+#define _DIRCACHE_H_INCLUDED
+
+#include "defs.h"
+
+// Directory listings cache
+// Every directory is read once per run when it is first looked into.
+// Thread-safe: included files are resolved by worker threads.
+
+#define DIR_CACHE_MISSING 0     // there is no such file
+#define DIR_CACHE_FILE    1     // regular file
+#define DIR_CACHE_UNKNOWN 2     // must be checked by system
+
+// Returns kind of a file "name" (relative path) in a directory "dir"
+// (full normalized path) found in directory listings.
+unsigned dir_cache_find_file (const char *dir, const char *name);
+
+#endif  // !_DIRCACHE_H_INCLUDED
@@ -0,0 +1,121 @@
+/* intern.c - global strings pool.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stddef.h>
+#include <string.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <pthread.h>
+#endif
+#include "debug.h"
+#include "arena.h"
+#include "l_hash.h"
+#include "intern.h"
+
+struct intern_entry_t
+{
+    struct hash_entry_t hash_entry;
+    unsigned len;
+    char str[];
+};
+
+struct arena_t _intern_arena;
+struct hash_t _intern_hash;
+
+// Strings are interned by worker threads too
+#if !defined (_WIN32) && !defined(_WIN64)
+pthread_mutex_t _intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+# define _intern_lock() pthread_mutex_lock (&_intern_mutex)
+# define _intern_unlock() pthread_mutex_unlock (&_intern_mutex)
+#else   // defined (_WIN32) || defined(_WIN64)
+# define _intern_lock()
+# define _intern_unlock()
+#endif  // defined (_WIN32) || defined(_WIN64)
+
+// Must be called locked.
+struct intern_entry_t *_intern_find (const char *s, unsigned len, unsigned hash)
+{
+    struct hash_entry_t *h;
+    struct intern_entry_t *p;
+
+    for (h = hash_first (&_intern_hash, hash); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct intern_entry_t, hash_entry);
+        if (p->len == len && !memcmp (p->str, s, len))
+            return p;
+    }
+    return NULL;
+}
+
+const char *intern_strn (const char *s, unsigned len)
+{
+    struct intern_entry_t *p;
+    unsigned hash;
+
+    if (!s)
+    {
+        _DBG ("Bad arguments.");
+        return NULL;
+    }
+
+    hash = hash_strn (s, len);
+
+    _intern_lock ();
+    p = _intern_find (s, len, hash);
+    if (!p)
+    {
+        p = arena_alloc (&_intern_arena, offsetof (struct intern_entry_t, str) + len + 1);
+        if (p)
+        {
+            hash_entry_clear (&p->hash_entry);
+            p->len = len;
+            memcpy (p->str, s, len);
+            p->str[len] = '\0';
+            if (hash_add_entry (&_intern_hash, &p->hash_entry, hash))
+            {
+                _perror ("hash_add_entry");
+                p = NULL;       // left in arena
+            }
+        }
+        else
+            _perror ("arena_alloc");
+    }
+    _intern_unlock ();
+
+    return p ? p->str : NULL;
+}
+
+const char *intern_str (const char *s)
+{
+    return s ? intern_strn (s, strlen (s)) : NULL;
+}
+
+const char *intern_lookup_n (const char *s, unsigned len)
+{
+    struct intern_entry_t *p;
+    unsigned hash;
+
+    if (!s)
+        return NULL;
+
+    hash = hash_strn (s, len);
+
+    _intern_lock ();
+    p = _intern_find (s, len, hash);
+    _intern_unlock ();
+
+    return p ? p->str : NULL;
+}
+
+const char *intern_lookup (const char *s)
+{
+    return s ? intern_lookup_n (s, strlen (s)) : NULL;
+}
+
+unsigned intern_hash (const char *s)
+{
+    return hash_entry_owner (s, struct intern_entry_t, str)->hash_entry.hash;
+}
@@ -0,0 +1,32 @@
+/* intern.h - declarations for "intern.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _INTERN_H_INCLUDED
+#define _INTERN_H_INCLUDED
+
+#include "defs.h"
+
+// Global strings pool
+// Every string is stored once and is never freed, so two interned strings
+// are equal if and only if their pointers are equal.
+
+// Returns interned string on success and "NULL" on fail.
+// "s" of "len" characters is not required to be zero-terminated.
+const char *intern_strn (const char *s, unsigned len);
+
+// Returns interned string on success and "NULL" on fail.
+const char *intern_str (const char *s);
+
+// Returns interned string equal to "s" of "len" characters or "NULL" if
+// there is none (nothing is added).
+const char *intern_lookup_n (const char *s, unsigned len);
+
+// Same as "intern_lookup_n" for a zero-terminated string.
+const char *intern_lookup (const char *s);
+
+// Returns hash value of an interned string (computed when it was added).
+unsigned intern_hash (const char *s);
+
+#endif  // !_INTERN_H_INCLUDED
@@ -0,0 +1,626 @@
+/* l_cache.c - scan cache list structure.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <fcntl.h>
+# include <sys/file.h>
+#endif
+#include "debug.h"
+#include "asmfile.h"
+#include "platform.h"
+#include "intern.h"
+#include "l_list.h"
+#include "l_hash.h"
+#include "l_ifile.h"
+#include "l_cache.h"
+
+// Cache file format (one record per line):
+//   aspp-cache <version> <syntax>
+//   F <size> <mtime> <real file>
+//   I <line> <flags> <included file>   (belongs to the last "F" record)
+
+#define CACHE_SIGNATURE "aspp-cache"
+#define CACHE_VERSION   1
+
+void
+    scan_cache_entry_clear
+    (
+        struct scan_cache_entry_t *self
+    )
+{
+    list_entry_clear (&self->list_entry);
+    hash_entry_clear (&self->hash_entry);
+    self->real = NULL;
+    self->size = 0;
+    self->mtime = 0;
+    self->changed = false;
+    self->seen = false;
+    self->watch = -1;
+    included_files_clear (&self->included);
+}
+
+void
+    scan_cache_entry_free
+    (
+        struct scan_cache_entry_t *self
+    )
+{
+    list_entry_free (&self->list_entry);
+    included_files_free (&self->included);
+    scan_cache_entry_clear (self);
+}
+
+void
+    scan_cache_clear
+    (
+        struct scan_cache_t *self
+    )
+{
+    list_clear (&self->list);
+    hash_clear (&self->hash);
+    self->changed = false;
+}
+
+bool
+    scan_cache_add
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        unsigned long long size,
+        long long mtime,
+        struct scan_cache_entry_t **result
+    )
+{
+    bool ok;
+    struct scan_cache_entry_t *p;
+    const char *p_real;
+
+    ok = false;
+    p = (struct scan_cache_entry_t *) NULL;
+
+    if (!self || !real)
+    {
+        _DBG ("Bad arguments.");
+        goto _local_exit;
+    }
+
+    p = malloc (sizeof (struct scan_cache_entry_t));
+    if (!p)
+    {
+        _perror ("malloc");
+        goto _local_exit;
+    }
+    p_real = intern_str (real);
+    if (!p_real)
+    {
+        _perror ("intern_str");
+        goto _local_exit;
+    }
+
+    scan_cache_entry_clear (p);
+    p->real = p_real;
+    p->size = size;
+    p->mtime = mtime;
+
+    if (hash_add_entry (&self->hash, &p->hash_entry, intern_hash (p->real)))
+    {
+        _perror ("hash_add_entry");
+        goto _local_exit;
+    }
+
+    list_add_entry (&self->list, &p->list_entry);
+
+    _DBG_ ("Added new cached file '%s'.", p->real);
+
+    ok = true;
+
+_local_exit:
+    if (!ok)
+    {
+        if (p)
+        {
+            free (p);
+            p = (struct scan_cache_entry_t *) NULL;
+        }
+    }
+    if (result)
+        *result = p;
+    return !ok;
+}
+
+bool
+    scan_cache_find
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        struct scan_cache_entry_t **result
+    )
+{
+    bool ok;
+    struct scan_cache_entry_t *p;
+    struct hash_entry_t *h;
+
+    ok = false;
+    p = (struct scan_cache_entry_t *) NULL;
+
+    if (!self || !real)
+    {
+        _DBG ("Bad arguments.");
+        goto _local_exit;
+    }
+
+    // A string which was never interned can not be found
+    real = intern_lookup (real);
+    if (!real)
+        goto _local_exit;       // Fail
+
+    for (h = hash_first (&self->hash, intern_hash (real)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct scan_cache_entry_t, hash_entry);
+        if (p->real == real)
+        {
+            // Success
+            ok = true;
+            goto _local_exit;
+        }
+    }
+
+    // Fail
+    p = (struct scan_cache_entry_t *) NULL;
+
+_local_exit:
+    if (result)
+        *result = p;
+    return !ok;
+}
+
+bool
+    scan_cache_update
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        unsigned long long size,
+        long long mtime,
+        struct included_files_t *included,
+        struct scan_cache_entry_t **result
+    )
+{
+    bool ok;
+    struct scan_cache_entry_t *p;
+
+    ok = false;
+    p = (struct scan_cache_entry_t *) NULL;
+
+    if (!self || !real || !included)
+    {
+        _DBG ("Bad arguments.");
+        goto _local_exit;
+    }
+
+    if (!scan_cache_find (self, real, &p))
+    {
+        included_files_free (&p->included);
+        p->size = size;
+        p->mtime = mtime;
+    }
+    else if (scan_cache_add (self, real, size, mtime, &p))
+        goto _local_exit;       // Fail
+
+    self->changed = true;
+    p->changed = true;
+    p->watch = -1;
+
+    if (included_files_append (&p->included, included))
+        goto _local_exit;       // Fail
+
+    ok = true;
+
+_local_exit:
+    if (result)
+        *result = p;
+    return !ok;
+}
+
+// Returns "true" if "s" is a record "<tag> <number> <number> <text>".
+// "text" may be empty (an included file name may be).
+bool
+    _scan_cache_parse_record
+    (
+        char *s,
+        char tag,
+        unsigned long long *a,
+        long long *b,
+        char **text
+    )
+{
+    char *endp;
+
+    if (s[0] != tag || s[1] != ' ')
+        return false;
+    s += 2;
+    *a = strtoull (s, &endp, 10);
+    if (endp == s || *endp != ' ')
+        return false;
+    s = endp + 1;
+    *b = strtoll (s, &endp, 10);
+    if (endp == s || *endp != ' ')
+        return false;
+    *text = endp + 1;
+    return true;
+}
+
+bool
+    scan_cache_is_header
+    (
+        const char *s,
+        const char *syntax
+    )
+{
+    char header[64];
+
+    snprintf (header, sizeof (header), "%s %u %s", CACHE_SIGNATURE, CACHE_VERSION, syntax);
+    return !strcmp (s, header);
+}
+
+bool
+    scan_cache_read_record
+    (
+        struct scan_cache_t *self,
+        char *s,
+        struct scan_cache_entry_t **last
+    )
+{
+    struct scan_cache_entry_t *p;
+    char *text;
+    unsigned long long a;
+    long long b;
+
+    if (_scan_cache_parse_record (s, 'F', &a, &b, &text) && *text)
+    {
+        if (!scan_cache_find (self, text, &p))
+        {
+            included_files_free (&p->included);
+            p->size = a;
+            p->mtime = b;
+            p->changed = false;
+            p->seen = false;
+            p->watch = -1;
+        }
+        else if (scan_cache_add (self, text, a, b, &p))
+            return true;        // Fail
+        *last = p;
+        return false;
+    }
+
+    if (*last && _scan_cache_parse_record (s, 'I', &a, &b, &text))
+        return included_files_add (&(*last)->included, a, b, text, strlen (text), NULL);
+
+    _DBG_ ("Bad cache record '%s'.", s);
+    return true;
+}
+
+bool
+    scan_cache_load
+    (
+        struct scan_cache_t *self,
+        const char *name,
+        const char *syntax
+    )
+{
+    bool ok;
+    struct asm_file_t file;
+    struct scan_cache_entry_t *p;
+    char *t;
+    const char *s;
+    unsigned tl, len;
+
+    if (!self || !name || !syntax)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    ok = false;
+    asm_file_clear (&file);
+    t = (char *) NULL;
+    tl = 0;
+    p = (struct scan_cache_entry_t *) NULL;
+
+    if (access (name, F_OK) < 0)
+    {
+        // Success (no cache yet)
+        _DBG_ ("No cache file '%s'.", name);
+        return false;
+    }
+
+    if (!asm_file_load (&file, name))
+    {
+        // Fail
+        goto _local_exit;
+    }
+
+    while (asm_file_next_line (&file, &s, &len))
+    {
+        if (tl < len + 1)
+        {
+            tl = len + 1;       // + terminating zero
+            if (t)
+                free (t);
+            t = malloc (tl);
+            if (!t)
+            {
+                // Fail
+                _perror ("malloc");
+                goto _local_exit;
+            }
+        }
+        memcpy (t, s, len);
+        t[len] = '\0';
+
+        if (asm_file_line (&file) == 1)
+        {
+            if (!scan_cache_is_header (t, syntax))
+            {
+                // Success (start over with an empty cache)
+                _DBG_ ("Cache file '%s' is of another version or syntax.", name);
+                ok = true;
+                goto _local_exit;
+            }
+        }
+        else if (scan_cache_read_record (self, t, &p))
+        {
+            // Fail
+            _DBG_ ("Bad cache file '%s' at line %u.", name, asm_file_line (&file));
+            goto _local_exit;
+        }
+    }
+
+    ok = true;
+
+_local_exit:
+    asm_file_free (&file);
+    if (t)
+        free (t);
+    if (!ok)
+        scan_cache_free (self);
+    self->changed = false;
+    return !ok;
+}
+
+bool
+    scan_cache_write
+    (
+        struct scan_cache_t *self,
+        FILE *stream,
+        const char *syntax,
+        bool changed_only
+    )
+{
+    const struct scan_cache_entry_t *p;
+    const struct included_file_entry_t *incl;
+    unsigned long long size;
+    long long mtime;
+
+    if (!self || !stream || !syntax)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    if (fprintf (stream, "%s %u %s" NL, CACHE_SIGNATURE, CACHE_VERSION, syntax) < 0)
+        return true;    // Fail
+
+    for (p = (struct scan_cache_entry_t *) self->list.first; p;
+         p = (struct scan_cache_entry_t *) p->list_entry.next)
+    {
+        if (changed_only && !p->changed)
+            continue;
+        if (!p->changed && !p->seen
+        &&  (!get_file_info (p->real, &size, &mtime) || p->size != size || p->mtime != mtime))
+        {
+            _DBG_ ("Dropped cached file '%s'.", p->real);
+            continue;
+        }
+        if (fprintf (stream, "F %llu %lld %s" NL, p->size, p->mtime, p->real) < 0)
+            return true;        // Fail
+        for (incl = (struct included_file_entry_t *) p->included.list.first; incl;
+             incl = (struct included_file_entry_t *) incl->list_entry.next)
+        {
+            if (fprintf (stream, "I %u %u %s" NL, incl->line, incl->flags, incl->name) < 0)
+                return true;    // Fail
+        }
+    }
+
+    return false;
+}
+
+// Returns "false" on success.
+// Takes records of cache file "name" saved by other runs meanwhile: files not
+// known to "self" and files neither scanned nor taken from cache during this
+// run (records of those are checked again when written).
+bool
+    _scan_cache_merge
+    (
+        struct scan_cache_t *self,
+        const char *name,
+        const char *syntax
+    )
+{
+    bool ok;
+    struct scan_cache_t saved;
+    const struct scan_cache_entry_t *q;
+    struct scan_cache_entry_t *p;
+
+    ok = false;
+    scan_cache_clear (&saved);
+
+    if (scan_cache_load (&saved, name, syntax))
+    {
+        // Success (a broken cache file is replaced)
+        ok = true;
+        goto _local_exit;
+    }
+
+    for (q = (struct scan_cache_entry_t *) saved.list.first; q;
+         q = (struct scan_cache_entry_t *) q->list_entry.next)
+    {
+        if (!scan_cache_find (self, q->real, &p))
+        {
+            if (p->changed || p->seen)
+                continue;       // checked during this run
+            included_files_free (&p->included);
+            p->size = q->size;
+            p->mtime = q->mtime;
+            p->watch = -1;
+        }
+        else if (scan_cache_add (self, q->real, q->size, q->mtime, &p))
+            goto _local_exit;   // Fail
+        if (included_files_append (&p->included, &q->included))
+            goto _local_exit;   // Fail
+    }
+
+    ok = true;
+
+_local_exit:
+    scan_cache_free (&saved);
+    return !ok;
+}
+
+bool
+    scan_cache_save
+    (
+        struct scan_cache_t *self,
+        const char *name,
+        const char *syntax
+    )
+{
+    bool ok;
+    FILE *f;
+    char *tmp;
+    unsigned len;
+    int lock;
+    bool created;
+
+    if (!self || !name || !syntax)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    if (!self->changed)
+        return false;   // Success (nothing to do)
+
+    ok = false;
+    f = (FILE *) NULL;
+    lock = -1;
+    created = false;
+
+    len = strlen (name) + 1 + 20 + 1;
+    tmp = malloc (len);
+    if (!tmp)
+    {
+        _perror ("malloc");
+        goto _local_exit;
+    }
+
+    // Concurrent runs sharing a cache file save it one at a time, each one
+    // merging records saved by others (on Windows the last one wins instead)
+#if !defined (_WIN32) && !defined(_WIN64)
+    snprintf (tmp, len, "%s.lock", name);
+    lock = open (tmp, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (lock < 0)
+    {
+        _perror ("open");
+        goto _local_exit;
+    }
+    while (flock (lock, LOCK_EX) < 0)
+    {
+        if (errno != EINTR)
+        {
+            _perror ("flock");
+            goto _local_exit;
+        }
+    }
+#endif
+    if (_scan_cache_merge (self, name, syntax))
+        goto _local_exit;       // Fail
+
+    // Write a temporary file and rename it so concurrent runs never see a partial cache
+    snprintf (tmp, len, "%s.%u", name, (unsigned) getpid ());
+
+    f = fopen (tmp, "w");
+    if (!f)
+    {
+        _perror ("fopen");
+        goto _local_exit;
+    }
+    created = true;
+
+    if (scan_cache_write (self, f, syntax, false))
+        goto _local_exit;       // Fail
+
+    if (fclose (f))
+    {
+        f = (FILE *) NULL;
+        _perror ("fclose");
+        goto _local_exit;
+    }
+    f = (FILE *) NULL;
+
+#if defined (_WIN32) || defined(_WIN64)
+    remove (name);
+#endif
+    if (rename (tmp, name))
+    {
+        _perror ("rename");
+        goto _local_exit;
+    }
+
+    self->changed = false;
+    ok = true;
+
+_local_exit:
+    if (f)
+        fclose (f);
+    if (tmp)
+    {
+        if (!ok && created)
+            remove (tmp);
+        free (tmp);
+    }
+#if !defined (_WIN32) && !defined(_WIN64)
+    if (lock >= 0)
+        close (lock);   // releases the lock
+#endif
+    return !ok;
+}
+
+void
+    scan_cache_free
+    (
+        struct scan_cache_t *self
+    )
+{
+    struct scan_cache_entry_t *p, *n;
+
+    p = (struct scan_cache_entry_t *) self->list.first;
+    while (p)
+    {
+        n = (struct scan_cache_entry_t *) p->list_entry.next;
+        scan_cache_entry_free (p);
+        free (p);
+        p = n;
+    }
+    hash_free (&self->hash);
+    scan_cache_clear (self);
+}
@@ -0,0 +1,160 @@
+/* l_cache.h - declarations for "l_cache.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _L_CACHE_H_INCLUDED
+#define _L_CACHE_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "l_list.h"
+#include "l_hash.h"
+#include "l_ifile.h"
+
+// Scan cache list structure
+
+// Entry
+
+struct scan_cache_entry_t
+{
+    struct list_entry_t list_entry;
+    struct hash_entry_t hash_entry;     // indexed by "real"
+    const char *real;   // interned
+    unsigned long long size;
+    long long mtime;
+    bool changed;       // scanned during this run
+    bool seen;          // taken from cache during this run
+    int watch;          // watch descriptor if file is watched for changes, -1 or SCAN_CACHE_STALE
+    struct included_files_t included;
+};
+
+// "watch" value of a file which path was changed (it must be scanned again)
+#define SCAN_CACHE_STALE -2
+
+// Files modified this close (in nanoseconds) to the start of their scan are
+// not cached: a change made within the same timestamp could not be noticed
+// (2 seconds is the coarsest timestamp granularity of common file systems).
+#define SCAN_CACHE_RACY_TIME (2 * 1000000000LL)
+
+void
+    scan_cache_entry_clear
+    (
+        struct scan_cache_entry_t *self
+    );
+
+void
+    scan_cache_entry_free
+    (
+        struct scan_cache_entry_t *self
+    );
+
+// List
+
+struct scan_cache_t
+{
+    struct list_t list;
+    struct hash_t hash;
+    bool changed;
+};
+
+void
+    scan_cache_clear
+    (
+        struct scan_cache_t *self
+    );
+
+// Returns "false" on success ("result" if presents is set to list entry).
+bool
+    scan_cache_add
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        unsigned long long size,
+        long long mtime,
+        struct scan_cache_entry_t **result
+    );
+
+// Returns "false" on success ("result" if presents is set to list entry).
+bool
+    scan_cache_find
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        struct scan_cache_entry_t **result
+    );
+
+// Returns "false" on success ("result" if presents is set to list entry).
+// Replaces included files list of a cached file (adds a new entry if needed).
+bool
+    scan_cache_update
+    (
+        struct scan_cache_t *self,
+        const char *real,
+        unsigned long long size,
+        long long mtime,
+        struct included_files_t *included,
+        struct scan_cache_entry_t **result
+    );
+
+// Returns "true" if "s" is a cache header line for the given syntax.
+bool
+    scan_cache_is_header
+    (
+        const char *s,
+        const char *syntax
+    );
+
+// Returns "false" on success ("last" is set to the last file record).
+// A file record replaces an existing entry with the same name.
+bool
+    scan_cache_read_record
+    (
+        struct scan_cache_t *self,
+        char *s,
+        struct scan_cache_entry_t **last
+    );
+
+// Returns "false" on success. A missing cache file is not an error.
+// A cache file made for another syntax or version is ignored.
+// On fail the cache is left empty.
+bool
+    scan_cache_load
+    (
+        struct scan_cache_t *self,
+        const char *name,
+        const char *syntax
+    );
+
+// Returns "false" on success.
+// Entries neither scanned nor taken from cache during this run are written
+// only if their files are not changed (unless "changed_only" is set).
+bool
+    scan_cache_write
+    (
+        struct scan_cache_t *self,
+        FILE *stream,
+        const char *syntax,
+        bool changed_only
+    );
+
+// Returns "false" on success.
+// Records saved to "name" by concurrent runs meanwhile are merged in under a
+// lock on file "name.lock" (which is left in place).
+bool
+    scan_cache_save
+    (
+        struct scan_cache_t *self,
+        const char *name,
+        const char *syntax
+    );
+
+void
+    scan_cache_free
+    (
+        struct scan_cache_t *self
+    );
+
+#endif  // !_L_CACHE_H_INCLUDED
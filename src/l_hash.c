@@ -0,0 +1,193 @@
+/* l_hash.c - basic hash index structure.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "debug.h"
+#include "l_hash.h"
+
+#define HASH_INITIAL_SIZE 64    // must be a power of 2
+
+void
+    hash_entry_clear
+    (
+        struct hash_entry_t *self
+    )
+{
+    self->next = NULL;
+    self->hash = 0;
+}
+
+void
+    hash_clear
+    (
+        struct hash_t *self
+    )
+{
+    self->buckets = NULL;
+    self->size = 0;
+    self->count = 0;
+}
+
+// FNV-1a
+unsigned
+    hash_str
+    (
+        const char *s
+    )
+{
+    unsigned h;
+
+    h = 2166136261U;
+    while (*s)
+    {
+        h ^= (unsigned char) *s;
+        h *= 16777619U;
+        s++;
+    }
+    return h;
+}
+
+// FNV-1a
+unsigned
+    hash_strn
+    (
+        const char *s,
+        unsigned len
+    )
+{
+    unsigned h;
+
+    h = 2166136261U;
+    while (len)
+    {
+        h ^= (unsigned char) *s;
+        h *= 16777619U;
+        s++;
+        len--;
+    }
+    return h;
+}
+
+// Returns "false" on success.
+bool
+    _hash_resize
+    (
+        struct hash_t *self,
+        unsigned size
+    )
+{
+    struct hash_entry_t **buckets, *p, *n;
+    unsigned i, j;
+
+    buckets = calloc (size, sizeof (struct hash_entry_t *));
+    if (!buckets)
+    {
+        _perror ("calloc");
+        return true;
+    }
+
+    for (i = 0; i < self->size; i++)
+    {
+        p = self->buckets[i];
+        while (p)
+        {
+            n = p->next;
+            j = p->hash & (size - 1);
+            p->next = buckets[j];
+            buckets[j] = p;
+            p = n;
+        }
+    }
+
+    if (self->buckets)
+        free (self->buckets);
+    self->buckets = buckets;
+    self->size = size;
+    return false;
+}
+
+bool
+    hash_add_entry
+    (
+        struct hash_t *self,
+        struct hash_entry_t *p,
+        unsigned hash
+    )
+{
+    unsigned i;
+
+    if (!self || !p)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    // Keep load factor below 3/4
+    if (!self->size)
+    {
+        if (_hash_resize (self, HASH_INITIAL_SIZE))
+            return true;
+    }
+    else if ((self->count + 1) * 4 > self->size * 3)
+    {
+        if (_hash_resize (self, self->size * 2))
+            return true;
+    }
+
+    i = hash & (self->size - 1);
+    p->hash = hash;
+    p->next = self->buckets[i];
+    self->buckets[i] = p;
+    self->count++;
+    return false;
+}
+
+struct hash_entry_t *
+    hash_first
+    (
+        const struct hash_t *self,
+        unsigned hash
+    )
+{
+    struct hash_entry_t *p;
+
+    if (!self || !self->size)
+        return (struct hash_entry_t *) NULL;
+
+    p = self->buckets[hash & (self->size - 1)];
+    while (p && p->hash != hash)
+        p = p->next;
+    return p;
+}
+
+struct hash_entry_t *
+    hash_next
+    (
+        const struct hash_entry_t *p
+    )
+{
+    unsigned hash;
+
+    hash = p->hash;
+    p = p->next;
+    while (p && p->hash != hash)
+        p = p->next;
+    return (struct hash_entry_t *) p;
+}
+
+void
+    hash_free
+    (
+        struct hash_t *self
+    )
+{
+    if (self->buckets)
+        free (self->buckets);
+    hash_clear (self);
+}
@@ -0,0 +1,97 @@
+/* l_hash.h - declarations for "l_hash.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _L_HASH_H_INCLUDED
+#define _L_HASH_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Hash index structure (entries are owned by the caller)
+
+// Entry
+
+struct hash_entry_t
+{
+    struct hash_entry_t *next;
+    unsigned hash;
+};
+
+// Returns pointer to a structure of type "type" containing "p" as "member".
+#define hash_entry_owner(p, type, member) \
+    ((type *) ((char *) (p) - offsetof (type, member)))
+
+void
+    hash_entry_clear
+    (
+        struct hash_entry_t *self
+    );
+
+// Index
+
+struct hash_t
+{
+    struct hash_entry_t **buckets;
+    unsigned size;
+    unsigned count;
+};
+
+void
+    hash_clear
+    (
+        struct hash_t *self
+    );
+
+// Returns hash value of a zero-terminated string.
+unsigned
+    hash_str
+    (
+        const char *s
+    );
+
+// Returns hash value of a string "s" of "len" characters (same as of a
+// zero-terminated string of the same characters).
+unsigned
+    hash_strn
+    (
+        const char *s,
+        unsigned len
+    );
+
+// Returns "false" on success.
+bool
+    hash_add_entry
+    (
+        struct hash_t *self,
+        struct hash_entry_t *p,
+        unsigned hash
+    );
+
+// Returns first entry of a chain which may hold "hash" or "NULL".
+// Use "hash_next" to walk through entries with the same "hash".
+struct hash_entry_t *
+    hash_first
+    (
+        const struct hash_t *self,
+        unsigned hash
+    );
+
+// Returns next entry with the same hash value as "p" or "NULL".
+struct hash_entry_t *
+    hash_next
+    (
+        const struct hash_entry_t *p
+    );
+
+// Free the index, but not the entries
+void
+    hash_free
+    (
+        struct hash_t *self
+    );
+
+#endif  // !_L_HASH_H_INCLUDED
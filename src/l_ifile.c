@@ -12,6 +12,8 @@
 #include <string.h>
 #include "debug.h"
 #include "platform.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
 #include "l_ifile.h"
 
@@ -25,6 +27,7 @@ void
     self->line = 0;     // invalid
     self->flags = 0;
     self->name = NULL;
+    self->source = NULL;
 }
 
 void
@@ -33,9 +36,8 @@ void
         struct included_file_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->name)
-        free (self->name);
     included_file_entry_clear (self);
 }
 
@@ -46,6 +48,7 @@ void
     )
 {
     list_clear (&self->list);
+    arena_clear (&self->arena);
 }
 
 bool
@@ -55,19 +58,19 @@ bool
         unsigned line,
         unsigned flags,
         const char *name,
+        unsigned len,
         struct included_file_entry_t **result
     )
 {
     bool ok;
     struct included_file_entry_t *p;
-    char *p_name;
+    const char *p_name;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct included_file_entry_t *) NULL;
-    p_name = (char *) NULL;
 
     if (!self || !name)
     {
@@ -75,16 +78,16 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct included_file_entry_t));
+    p = arena_alloc (&self->arena, sizeof (struct included_file_entry_t));
     if (!p)
     {
-        _perror ("malloc");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
-    p_name = strdup (name);
+    p_name = intern_strn (name, len);
     if (!p_name)
     {
-        _perror ("strdup");
+        _perror ("intern_strn");
         goto _local_exit;
     }
 
@@ -107,25 +110,43 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct included_file_entry_t *) NULL;
-        }
-        if (p_name)
-            free (p_name);
-    }
+        p = (struct included_file_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
 }
 
+bool
+    included_files_append
+    (
+        struct included_files_t *self,
+        const struct included_files_t *src
+    )
+{
+    const struct included_file_entry_t *p;
+
+    if (!self || !src)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    for (p = (struct included_file_entry_t *) src->list.first; p;
+         p = (struct included_file_entry_t *) p->list_entry.next)
+    {
+        if (included_files_add (self, p->line, p->flags, p->name, strlen (p->name), NULL))
+            return true;        // Fail
+    }
+
+    return false;
+}
+
 bool
     included_files_find
     (
         struct included_files_t *self,
         const char *name,
+        unsigned len,
         struct included_file_entry_t **result
     )
 {
@@ -142,11 +163,20 @@ bool
         goto _local_exit;
     }
 
+    p = (struct included_file_entry_t *) NULL;
+    name = intern_lookup_n (name, len);
+    if (!name)
+    {
+        // Fail
+        _DBG ("Failed to find included file.");
+        goto _local_exit;
+    }
+
     p = (struct included_file_entry_t *) self->list.first;
     i = 0;
     while (p)
     {
-        if (!strcmp (p->name, name))
+        if (p->name == name)
         {
             // Success
             _DBG_ ("Found included file '%s' at #%u.", p->name, i);
@@ -173,15 +203,6 @@ void
         struct included_files_t *self
     )
 {
-    struct included_file_entry_t *p, *n;
-
-    p = (struct included_file_entry_t *) self->list.first;
-    while (p)
-    {
-        n = (struct included_file_entry_t *) p->list_entry.next;
-        included_file_entry_free (p);
-        free (p);
-        p = n;
-    }
+    arena_free (&self->arena);
     included_files_clear (self);
 }
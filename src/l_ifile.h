@@ -9,12 +9,16 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include "arena.h"
 #include "l_list.h"
 
 // Include files list structure
 
 #define SRCFL_NONE  0
 #define SRCFL_PARSE (1 << 0)
+#define SRCFL_FAIL  (1 << 1)    // source state: failed to parse
+
+struct source_entry_t;
 
 // Entry
 
@@ -23,7 +27,8 @@ struct included_file_entry_t
     struct list_entry_t list_entry;
     unsigned line;
     unsigned flags;
-    char *name;
+    const char *name;   // interned
+    struct source_entry_t *source;      // resolved source (if any)
 };
 
 void
@@ -43,6 +48,7 @@ void
 struct included_files_t
 {
     struct list_t list;
+    struct arena_t arena;       // entries
 };
 
 void
@@ -51,6 +57,8 @@ void
         struct included_files_t *self
     );
 
+// Returns "false" on success ("result" if presents is set to list entry).
+// "name" of "len" characters is not required to be zero-terminated.
 bool
     included_files_add
     (
@@ -58,15 +66,26 @@ bool
         unsigned line,
         unsigned flags,
         const char *name,
+        unsigned len,
         struct included_file_entry_t **result
     );
 
+// Returns "false" on success. Appends copies of all entries of "src" list.
+bool
+    included_files_append
+    (
+        struct included_files_t *self,
+        const struct included_files_t *src
+    );
+
 // Returns "false" on success ("result" if presents is set to list entry).
+// "name" of "len" characters is not required to be zero-terminated.
 bool
     included_files_find
     (
         struct included_files_t *self,
         const char *name,
+        unsigned len,
         struct included_file_entry_t **result
     );
 
@@ -12,6 +12,11 @@
 #include <string.h>
 #include "debug.h"
 #include "platform.h"
+#include "probe.h"
+#include "dircache.h"
+#include "stats.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
 #include "l_inc.h"
 
@@ -25,6 +30,7 @@ void
     self->real = NULL;
     self->base = NULL;
     self->user = NULL;
+    self->fd = -1;
 }
 
 void
@@ -33,13 +39,8 @@ void
         struct include_path_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->real)
-        free (self->real);
-    if (self->base)
-        free (self->base);
-    if (self->user)
-        free (self->user);
     include_path_entry_clear (self);
 }
 
@@ -50,6 +51,8 @@ void
     )
 {
     list_clear (&self->list);
+    arena_clear (&self->arena);
+    self->listed = false;
 }
 
 bool
@@ -64,16 +67,13 @@ bool
 {
     bool ok;
     struct include_path_entry_t *p;
-    char *p_real, *p_base, *p_user;
+    const char *p_real, *p_base, *p_user;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct include_path_entry_t *) NULL;
-    p_real = (char *) NULL;
-    p_base = (char *) NULL;
-    p_user = (char *) NULL;
 
     if (!self || !real || !base || !user)
     {
@@ -81,28 +81,18 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct include_path_entry_t));
+    p = arena_alloc (&self->arena, sizeof (struct include_path_entry_t));
     if (!p)
     {
-        _perror ("malloc");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
-    p_real = strdup (real);
-    if (!p_real)
+    p_real = intern_str (real);
+    p_base = intern_str (base);
+    p_user = intern_str (user);
+    if (!p_real || !p_base || !p_user)
     {
-        _perror ("strdup");
-        goto _local_exit;
-    }
-    p_base = strdup (base);
-    if (!p_base)
-    {
-        _perror ("strdup");
-        goto _local_exit;
-    }
-    p_user = strdup (user);
-    if (!p_user)
-    {
-        _perror ("strdup");
+        _perror ("intern_str");
         goto _local_exit;
     }
 
@@ -110,6 +100,7 @@ bool
     p->real = p_real;
     p->base = p_base;
     p->user = p_user;
+    p->fd = probe_dir_fd (p_real);      // kept open by "probe"
 
 #if DEBUG == 1
     i = self->list.count;
@@ -125,19 +116,7 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct include_path_entry_t *) NULL;
-        }
-        if (p_real)
-            free (p_real);
-        if (p_base)
-            free (p_base);
-        if (p_user)
-            free (p_user);
-    }
+        p = (struct include_path_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
@@ -164,11 +143,20 @@ bool
         goto _local_exit;
     }
 
+    p = (struct include_path_entry_t *) NULL;
+    real = intern_lookup (real);
+    if (!real)
+    {
+        // Fail
+        _DBG ("Failed to find real path.");
+        goto _local_exit;
+    }
+
     p = (struct include_path_entry_t *) self->list.first;
     i = 0;
     while (p)
     {
-        if (!strcmp (p->real, real))
+        if (p->real == real)
         {
             // Success
             _DBG_ ("Found user path '%s' (real path '%s') at #%u.", p->user, p->real, i);
@@ -210,11 +198,20 @@ bool
         goto _local_exit;
     }
 
+    p = (struct include_path_entry_t *) NULL;
+    user = intern_lookup (user);
+    if (!user)
+    {
+        // Fail
+        _DBG ("Failed to find user path.");
+        goto _local_exit;
+    }
+
     p = (struct include_path_entry_t *) self->list.first;
     i = 0;
     while (p)
     {
-        if (!strcmp (p->user, user))
+        if (p->user == user)
         {
             // Success
             _DBG_ ("Found user path '%s' (real path '%s') at #%u.", p->user, p->real, i);
@@ -311,7 +308,7 @@ bool
                 goto _local_exit;
             }
             // trying real path - we are lucky
-            if (check_path_exists (real))
+            if (probe_is_dir (real))
             {
                 if (!include_paths_add (self, real, base_path_real, user, result))
                 {
@@ -347,15 +344,13 @@ bool
     )
 {
     bool ok;
-    char *real;
     struct include_path_entry_t *p;
-    unsigned len;
+    unsigned kind;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
-    real = (char *) NULL;
     p = (struct include_path_entry_t *) NULL;
 
     if (!self || !user)
@@ -364,29 +359,21 @@ bool
         goto _local_exit;
     }
 
-    len = PATH_MAX + 1 + strlen (user) + 1;
-    real = malloc (len);
-    if (!real)
-    {
-        // Fail
-        _perror ("malloc");
-        goto _local_exit;
-    }
-
     p = (struct include_path_entry_t *) self->list.first;
 #if DEBUG == 1
     i = 0;
 #endif  // DEBUG == 1
     while (p)
     {
-        snprintf (real, len, "%s" PATHSEPSTR "%s", p->real, user);
         _DBG_ ("Checking user file '%s' at path '%s'...", user, p->real);
-        if (check_file_exists (real))
+        kind = self->listed ? dir_cache_find_file (p->real, user) : DIR_CACHE_UNKNOWN;
+        if (kind != DIR_CACHE_UNKNOWN)
+            stats_add (STAT_LISTING_HITS, 1);
+        if (kind == DIR_CACHE_FILE
+        ||  (kind == DIR_CACHE_UNKNOWN && check_file_exists_at (p->real, p->fd, user)))
         {
             // Success
-#if DEBUG == 1
-            _DBG_ ("Found user file '%s' (real file '%s') at #%u.", user, real, i);
-#endif  // DEBUG == 1
+            _DBG_ ("Found user file '%s' at #%u.", user, i);
             ok = true;
             goto _local_exit;
         }
@@ -405,8 +392,6 @@ bool
     _DBG_ ("User file '%s' not resolved.", user);
 
 _local_exit:
-    if (real)
-        free (real);
     if (result)
         *result = p;
     return !ok;
@@ -453,15 +438,6 @@ void
         struct include_paths_t *self
     )
 {
-    struct include_path_entry_t *p, *n;
-
-    p = (struct include_path_entry_t *) self->list.first;
-    while (p)
-    {
-        n = (struct include_path_entry_t *) p->list_entry.next;
-        include_path_entry_free (p);
-        free (p);
-        p = n;
-    }
+    arena_free (&self->arena);
     include_paths_clear (self);
 }
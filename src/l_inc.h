@@ -9,6 +9,7 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include "arena.h"
 #include "l_list.h"
 
 // Include paths list structure
@@ -18,7 +19,8 @@
 struct include_path_entry_t
 {
     struct list_entry_t list_entry;
-    char *real, *base, *user;
+    const char *real, *base, *user;     // interned
+    int fd;             // opened "real" directory (see "probe_dir_fd") or -1
 };
 
 void
@@ -38,6 +40,8 @@ void
 struct include_paths_t
 {
     struct list_t list;
+    struct arena_t arena;       // entries
+    bool listed;        // resolve files by directory listings (see "dircache.h")
 };
 
 void
@@ -86,6 +90,7 @@ bool
     );
 
 // Returns "false" on success ("result" if presents is set to list entry).
+// With "listed" set files are looked up in cached directory listings first.
 bool
     include_paths_resolve_file
     (
@@ -12,7 +12,12 @@
 #include <string.h>
 #include "debug.h"
 #include "platform.h"
+#include "probe.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
+#include "l_hash.h"
+#include "l_tgt.h"
 #include "l_isrc.h"
 
 void
@@ -22,9 +27,13 @@ void
     )
 {
     list_entry_clear (&self->list_entry);
+    hash_entry_clear (&self->real_entry);
+    hash_entry_clear (&self->user_entry);
     self->real = NULL;
     self->base = NULL;
     self->user = NULL;
+    target_names_clear (&self->targets);
+    self->output = NULL;
 }
 
 void
@@ -33,16 +42,38 @@ void
         struct input_source_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->real)
-        free (self->real);
-    if (self->base)
-        free (self->base);
-    if (self->user)
-        free (self->user);
+    target_names_free (&self->targets);
     input_source_entry_clear (self);
 }
 
+bool
+    input_source_entry_set_output
+    (
+        struct input_source_entry_t *self,
+        const char *output
+    )
+{
+    const char *p_output;
+
+    if (!self || !output)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    p_output = intern_str (output);
+    if (!p_output)
+    {
+        _perror ("intern_str");
+        return true;
+    }
+
+    self->output = p_output;
+    return false;
+}
+
 void
     input_sources_clear
     (
@@ -50,6 +81,9 @@ void
     )
 {
     list_clear (&self->list);
+    hash_clear (&self->real_hash);
+    hash_clear (&self->user_hash);
+    arena_clear (&self->arena);
 }
 
 bool
@@ -64,16 +98,13 @@ bool
 {
     bool ok;
     struct input_source_entry_t *p;
-    char *p_real, *p_base, *p_user;
+    const char *p_real, *p_base, *p_user;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct input_source_entry_t *) NULL;
-    p_real = (char *) NULL;
-    p_base = (char *) NULL;
-    p_user = (char *) NULL;
 
     if (!self || !real || !base || !user)
     {
@@ -81,36 +112,37 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct input_source_entry_t));
+    p = arena_alloc (&self->arena, sizeof (struct input_source_entry_t));
     if (!p)
     {
-        _perror ("malloc");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
-    p_real = strdup (real);
-    if (!p_real)
+    p_real = intern_str (real);
+    p_base = intern_str (base);
+    p_user = intern_str (user);
+    if (!p_real || !p_base || !p_user)
     {
-        _perror ("strdup");
+        _perror ("intern_str");
         goto _local_exit;
     }
-    p_base = strdup (base);
-    if (!p_base)
+
+    input_source_entry_clear (p);
+    p->real = p_real;
+    p->base = p_base;
+    p->user = p_user;
+
+    if (hash_add_entry (&self->real_hash, &p->real_entry, intern_hash (p->real)))
     {
-        _perror ("strdup");
+        _perror ("hash_add_entry");
         goto _local_exit;
     }
-    p_user = strdup (user);
-    if (!p_user)
+    if (hash_add_entry (&self->user_hash, &p->user_entry, intern_hash (p->user)))
     {
-        _perror ("strdup");
+        _perror ("hash_add_entry");
         goto _local_exit;
     }
 
-    input_source_entry_clear (p);
-    p->real = p_real;
-    p->base = p_base;
-    p->user = p_user;
-
 #if DEBUG == 1
     i = self->list.count;
 #endif  // DEBUG == 1
@@ -125,19 +157,7 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct input_source_entry_t *) NULL;
-        }
-        if (p_real)
-            free (p_real);
-        if (p_base)
-            free (p_base);
-        if (p_user)
-            free (p_user);
-    }
+        p = (struct input_source_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
@@ -153,7 +173,7 @@ bool
 {
     bool ok;
     struct input_source_entry_t *p;
-    unsigned i;
+    struct hash_entry_t *h;
 
     ok = false;
     p = (struct input_source_entry_t *) NULL;
@@ -164,23 +184,29 @@ bool
         goto _local_exit;
     }
 
-    p = (struct input_source_entry_t *) self->list.first;
-    i = 0;
-    while (p)
+    // A string which was never interned can not be found
+    real = intern_lookup (real);
+    if (!real)
+    {
+        // Fail
+        _DBG ("Failed to find real file.");
+        goto _local_exit;
+    }
+
+    for (h = hash_first (&self->real_hash, intern_hash (real)); h; h = hash_next (h))
     {
-        if (!strcmp (p->real, real))
+        p = hash_entry_owner (h, struct input_source_entry_t, real_entry);
+        if (p->real == real)
         {
             // Success
-            _DBG_ ("Found user file '%s' (real file '%s') at #%u.", p->user, p->real, i);
+            _DBG_ ("Found user file '%s' (real file '%s').", p->user, p->real);
             ok = true;
             goto _local_exit;
         }
-        p = (struct input_source_entry_t *) p->list_entry.next;
-        i++;
     }
 
     // Fail
-    //p = (struct input_source_entry_t *) NULL;
+    p = (struct input_source_entry_t *) NULL;
     _DBG_ ("Failed to find real file '%s'.", real);
 
 _local_exit:
@@ -199,7 +225,7 @@ bool
 {
     bool ok;
     struct input_source_entry_t *p;
-    unsigned i;
+    struct hash_entry_t *h;
 
     ok = false;
     p = (struct input_source_entry_t *) NULL;
@@ -210,23 +236,28 @@ bool
         goto _local_exit;
     }
 
-    p = (struct input_source_entry_t *) self->list.first;
-    i = 0;
-    while (p)
+    user = intern_lookup (user);
+    if (!user)
     {
-        if (!strcmp (p->user, user))
+        // Fail
+        _DBG ("Failed to find user file.");
+        goto _local_exit;
+    }
+
+    for (h = hash_first (&self->user_hash, intern_hash (user)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct input_source_entry_t, user_entry);
+        if (p->user == user)
         {
             // Success
-            _DBG_ ("Found user file '%s' (real file '%s') at #%u.", p->user, p->real, i);
+            _DBG_ ("Found user file '%s' (real file '%s').", p->user, p->real);
             ok = true;
             goto _local_exit;
         }
-        p = (struct input_source_entry_t *) p->list_entry.next;
-        i++;
     }
 
     // Fail
-    //p = (struct input_source_entry_t *) NULL;
+    p = (struct input_source_entry_t *) NULL;
     _DBG_ ("Failed to find user file '%s'.", user);
 
 _local_exit:
@@ -313,7 +344,7 @@ bool
                 goto _local_exit;
             }
             // trying real path - we are lucky
-            if (check_file_exists (real))
+            if (probe_is_file (real))
             {
                 if (!input_sources_add (self, real, base_path_real, user, result))
                 {
@@ -367,6 +398,8 @@ void
             _DBG_ ("Input source #%u: user file = '%s'", i, ((struct input_source_entry_t *) p)->user);
             _DBG_ ("Input source #%u: base path = '%s'", i, ((struct input_source_entry_t *) p)->base);
             _DBG_ ("Input source #%u: real file = '%s'", i, ((struct input_source_entry_t *) p)->real);
+            _DBG_ ("Input source #%u: output file = '%s'", i, ((struct input_source_entry_t *) p)->output);
+            _DBG_target_names_dump (&((struct input_source_entry_t *) p)->targets);
             p = (struct input_source_entry_t *) ((struct input_source_entry_t *) p)->list_entry.next;
             i++;
         }
@@ -390,8 +423,10 @@ void
     {
         n = (struct input_source_entry_t *) p->list_entry.next;
         input_source_entry_free (p);
-        free (p);
         p = n;
     }
+    hash_free (&self->real_hash);
+    hash_free (&self->user_hash);
+    arena_free (&self->arena);
     input_sources_clear (self);
 }
@@ -9,8 +9,10 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include "arena.h"
 #include "l_list.h"
-#include "l_isrc.h"
+#include "l_hash.h"
+#include "l_tgt.h"
 
 // Input sources list structure
 
@@ -19,7 +21,11 @@
 struct input_source_entry_t
 {
     struct list_entry_t list_entry;
-    char *real, *base, *user;
+    struct hash_entry_t real_entry;     // indexed by "real"
+    struct hash_entry_t user_entry;     // indexed by "user"
+    const char *real, *base, *user;     // interned
+    struct target_names_t targets;      // rule's targets
+    const char *output;                 // rule's output file name (interned)
 };
 
 void
@@ -34,11 +40,22 @@ void
         struct input_source_entry_t *self
     );
 
+// Returns "false" on success.
+bool
+    input_source_entry_set_output
+    (
+        struct input_source_entry_t *self,
+        const char *output
+    );
+
 // List
 
 struct input_sources_t
 {
     struct list_t list;
+    struct hash_t real_hash;
+    struct hash_t user_hash;
+    struct arena_t arena;       // entries
 };
 
 void
@@ -11,7 +11,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "debug.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
+#include "strbuf.h"
+#include "l_hash.h"
 #include "l_pre.h"
 
 void
@@ -21,6 +25,7 @@ void
     )
 {
     list_entry_clear (&self->list_entry);
+    hash_entry_clear (&self->hash_entry);
     self->prerequisite = NULL;
 }
 
@@ -30,9 +35,8 @@ void
         struct prerequisite_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->prerequisite)
-        free (self->prerequisite);
     prerequisite_entry_clear (self);
 }
 
@@ -43,6 +47,8 @@ void
     )
 {
     list_clear (&self->list);
+    hash_clear (&self->hash);
+    arena_clear (&self->arena);
 }
 
 bool
@@ -55,14 +61,14 @@ bool
 {
     bool ok;
     struct prerequisite_entry_t *p;
-    char *p_prerequisite;
+    struct hash_entry_t *h;
+    const char *p_prerequisite;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct prerequisite_entry_t *) NULL;
-    p_prerequisite = (char *) NULL;
 
     if (!self || !prerequisite)
     {
@@ -70,22 +76,40 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct prerequisite_entry_t));
-    if (!p)
+    p_prerequisite = intern_str (prerequisite);
+    if (!p_prerequisite)
     {
-        _perror ("malloc");
+        _perror ("intern_str");
         goto _local_exit;
     }
-    p_prerequisite = strdup (prerequisite);
-    if (!p_prerequisite)
+
+    for (h = hash_first (&self->hash, intern_hash (p_prerequisite)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct prerequisite_entry_t, hash_entry);
+        if (p->prerequisite == p_prerequisite)
+        {
+            // Success (already added)
+            ok = true;
+            goto _local_exit;
+        }
+    }
+
+    p = arena_alloc (&self->arena, sizeof (struct prerequisite_entry_t));
+    if (!p)
     {
-        _perror ("strdup");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
 
-    p->list_entry.next = NULL;
+    prerequisite_entry_clear (p);
     p->prerequisite = p_prerequisite;
 
+    if (hash_add_entry (&self->hash, &p->hash_entry, intern_hash (p->prerequisite)))
+    {
+        _perror ("hash_add_entry");
+        goto _local_exit;
+    }
+
 #if DEBUG == 1
     i = self->list.count;
 #endif  // DEBUG == 1
@@ -97,15 +121,7 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct prerequisite_entry_t *) NULL;
-        }
-        if (p_prerequisite)
-            free (p_prerequisite);
-    }
+        p = (struct prerequisite_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
@@ -115,13 +131,14 @@ bool
     prerequisites_print
     (
         struct prerequisites_t *self,
-        FILE *stream
+        struct strbuf_t *buf,
+        strbuf_add_proc_t *add
     )
 {
     const struct prerequisite_entry_t *p;
     bool padding;
 
-    if (!self || !stream)
+    if (!self || !buf || !add)
     {
         _DBG ("Bad arguments.");
         return true;
@@ -131,11 +148,9 @@ bool
     for (p = (struct prerequisite_entry_t *) self->list.first; p;
          p = (struct prerequisite_entry_t *) p->list_entry.next)
     {
-        if (fprintf (stream, padding ? " %s" : "%s", p->prerequisite) < 0)
-        {
-            _perror ("fprintf");
-            return true;
-        }
+        if ((padding && strbuf_add_char (buf, ' '))
+        ||  add (buf, p->prerequisite))
+            return true;        // Fail
         padding = true;
     }
 
@@ -148,15 +163,7 @@ void
         struct prerequisites_t *self
     )
 {
-    struct prerequisite_entry_t *p, *n;
-
-    p = (struct prerequisite_entry_t *) self->list.first;
-    while (p)
-    {
-        n = (struct prerequisite_entry_t *) p->list_entry.next;
-        prerequisite_entry_free (p);
-        free (p);
-        p = n;
-    }
+    hash_free (&self->hash);
+    arena_free (&self->arena);
     prerequisites_clear (self);
 }
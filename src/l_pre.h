@@ -9,16 +9,20 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include "arena.h"
 #include "l_list.h"
+#include "strbuf.h"
+#include "l_hash.h"
 
-// Prerequisites list structure
+// Prerequisites set structure (keeps order of addition)
 
 // Entry
 
 struct prerequisite_entry_t
 {
     struct list_entry_t list_entry;
-    char *prerequisite;
+    struct hash_entry_t hash_entry;     // indexed by "prerequisite"
+    const char *prerequisite;   // interned
 };
 
 void
@@ -38,6 +42,8 @@ void
 struct prerequisites_t
 {
     struct list_t list;
+    struct hash_t hash;
+    struct arena_t arena;       // entries
 };
 
 void
@@ -47,6 +53,7 @@ void
     );
 
 // Returns "false" on success ("result" if presents is set to list entry).
+// A prerequisite which is already in the set is not added again.
 bool
     prerequisites_add
     (
@@ -56,11 +63,13 @@ bool
     );
 
 // Returns "false" on success.
+// Appends space-separated list to "buf". Every name is added by "add".
 bool
     prerequisites_print
     (
         struct prerequisites_t *self,
-        FILE *stream
+        struct strbuf_t *buf,
+        strbuf_add_proc_t *add
     );
 
 void
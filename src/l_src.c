@@ -11,7 +11,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "debug.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
+#include "l_hash.h"
 #include "l_src.h"
 
 void
@@ -21,10 +24,12 @@ void
     )
 {
     list_entry_clear (&self->list_entry);
+    hash_entry_clear (&self->hash_entry);
     self->real = NULL;
     self->base = NULL;
     self->user = NULL;
     self->flags = 0;
+    self->mark = 0;
     included_files_clear (&self->included);
 }
 
@@ -34,13 +39,8 @@ void
         struct source_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->real)
-        free (self->real);
-    if (self->base)
-        free (self->base);
-    if (self->user)
-        free (self->user);
     included_files_free (&self->included);
     source_entry_clear (self);
 }
@@ -52,6 +52,8 @@ void
     )
 {
     list_clear (&self->list);
+    hash_clear (&self->hash);
+    arena_clear (&self->arena);
 }
 
 bool
@@ -67,16 +69,13 @@ bool
 {
     bool ok;
     struct source_entry_t *p;
-    char *p_real, *p_base, *p_user;
+    const char *p_real, *p_base, *p_user;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct source_entry_t *) NULL;
-    p_real = (char *) NULL;
-    p_base = (char *) NULL;
-    p_user = (char *) NULL;
 
     if (!self || !real || !base || !user)
     {
@@ -84,28 +83,18 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct source_entry_t));
+    p = arena_alloc (&self->arena, sizeof (struct source_entry_t));
     if (!p)
     {
-        _perror ("malloc");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
-    p_real = strdup (real);
-    if (!p_real)
+    p_real = intern_str (real);
+    p_base = intern_str (base);
+    p_user = intern_str (user);
+    if (!p_real || !p_base || !p_user)
     {
-        _perror ("strdup");
-        goto _local_exit;
-    }
-    p_base = strdup (base);
-    if (!p_base)
-    {
-        _perror ("strdup");
-        goto _local_exit;
-    }
-    p_user = strdup (user);
-    if (!p_user)
-    {
-        _perror ("strdup");
+        _perror ("intern_str");
         goto _local_exit;
     }
 
@@ -115,6 +104,12 @@ bool
     p->user = p_user;
     p->flags = flags;
 
+    if (hash_add_entry (&self->hash, &p->hash_entry, intern_hash (p->real)))
+    {
+        _perror ("hash_add_entry");
+        goto _local_exit;
+    }
+
 #if DEBUG == 1
     i = self->list.count;
 #endif  // DEBUG == 1
@@ -130,19 +125,7 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct source_entry_t *) NULL;
-        }
-        if (p_real)
-            free (p_real);
-        if (p_base)
-            free (p_base);
-        if (p_user)
-            free (p_user);
-    }
+        p = (struct source_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
@@ -158,7 +141,7 @@ bool
 {
     bool ok;
     struct source_entry_t *p;
-    unsigned i;
+    struct hash_entry_t *h;
 
     ok = false;
     p = (struct source_entry_t *) NULL;
@@ -169,23 +152,29 @@ bool
         goto _local_exit;
     }
 
-    p = (struct source_entry_t *) self->list.first;
-    i = 0;
-    while (p)
+    // A string which was never interned can not be found
+    real = intern_lookup (real);
+    if (!real)
+    {
+        // Fail
+        _DBG ("Failed to find real file.");
+        goto _local_exit;
+    }
+
+    for (h = hash_first (&self->hash, intern_hash (real)); h; h = hash_next (h))
     {
-        if (!strcmp (p->real, real))
+        p = hash_entry_owner (h, struct source_entry_t, hash_entry);
+        if (p->real == real)
         {
             // Success
-            _DBG_ ("Found user file '%s' (real file '%s') at #%u.", p->user, p->real, i);
+            _DBG_ ("Found user file '%s' (real file '%s').", p->user, p->real);
             ok = true;
             goto _local_exit;
         }
-        p = (struct source_entry_t *) p->list_entry.next;
-        i++;
     }
 
     // Fail
-    //p = (struct source_entry_t *) NULL;
+    p = (struct source_entry_t *) NULL;
     _DBG_ ("Failed to find real file '%s'.", real);
 
 _local_exit:
@@ -215,11 +204,20 @@ bool
         goto _local_exit;
     }
 
+    p = (struct source_entry_t *) NULL;
+    user = intern_lookup (user);
+    if (!user)
+    {
+        // Fail
+        _DBG ("Failed to find user file.");
+        goto _local_exit;
+    }
+
     p = (struct source_entry_t *) self->list.first;
     i = 0;
     while (p)
     {
-        if (!strcmp (p->user, user))
+        if (p->user == user)
         {
             // Success
             _DBG_ ("Found user file '%s' (real file '%s') at #%u.", p->user, p->real, i);
@@ -253,8 +251,9 @@ void
     {
         n = (struct source_entry_t *) p->list_entry.next;
         source_entry_free (p);
-        free (p);
         p = n;
     }
+    hash_free (&self->hash);
+    arena_free (&self->arena);
     sources_clear (self);
 }
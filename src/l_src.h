@@ -9,7 +9,9 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include "arena.h"
 #include "l_list.h"
+#include "l_hash.h"
 #include "l_ifile.h"
 
 // Sources list structure
@@ -19,8 +21,10 @@
 struct source_entry_t
 {
     struct list_entry_t list_entry;
-    char *real, *base, *user;
+    struct hash_entry_t hash_entry;     // indexed by "real"
+    const char *real, *base, *user;     // interned
     unsigned flags;
+    unsigned mark;      // last rule which visited this source
     struct included_files_t included;
 };
 
@@ -41,6 +45,8 @@ void
 struct sources_t
 {
     struct list_t list;
+    struct hash_t hash;
+    struct arena_t arena;       // entries
 };
 
 void
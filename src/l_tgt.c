@@ -9,7 +9,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "debug.h"
+#include "arena.h"
+#include "intern.h"
 #include "l_list.h"
+#include "strbuf.h"
 #include "l_tgt.h"
 
 void
@@ -28,9 +31,8 @@ void
         struct target_name_entry_t *self
     )
 {
+    // Entry is released with the list's arena
     list_entry_free (&self->list_entry);
-    if (self->name)
-        free (self->name);
     target_name_entry_clear (self);
 }
 
@@ -41,6 +43,7 @@ void
     )
 {
     list_clear (&self->list);
+    arena_clear (&self->arena);
 }
 
 bool
@@ -53,14 +56,13 @@ bool
 {
     bool ok;
     struct target_name_entry_t *p;
-    char *p_name;
+    const char *p_name;
 #if DEBUG == 1
     unsigned i;
 #endif  // DEBUG == 1
 
     ok = false;
     p = (struct target_name_entry_t *) NULL;
-    p_name = (char *) NULL;
 
     if (!self || !name)
     {
@@ -68,16 +70,16 @@ bool
         goto _local_exit;
     }
 
-    p = malloc (sizeof (struct target_name_entry_t));
+    p = arena_alloc (&self->arena, sizeof (struct target_name_entry_t));
     if (!p)
     {
-        _perror ("malloc");
+        _perror ("arena_alloc");
         goto _local_exit;
     }
-    p_name = strdup (name);
+    p_name = intern_str (name);
     if (!p_name)
     {
-        _perror ("strdup");
+        _perror ("intern_str");
         goto _local_exit;
     }
 
@@ -95,15 +97,7 @@ bool
 
 _local_exit:
     if (!ok)
-    {
-        if (p)
-        {
-            free (p);
-            p = (struct target_name_entry_t *) NULL;
-        }
-        if (p_name)
-            free (p_name);
-    }
+        p = (struct target_name_entry_t *) NULL;
     if (result)
         *result = p;
     return !ok;
@@ -113,13 +107,14 @@ bool
     target_names_print
     (
         struct target_names_t *self,
-        FILE *stream
+        struct strbuf_t *buf,
+        strbuf_add_proc_t *add
     )
 {
     const struct target_name_entry_t *p;
     bool padding;
 
-    if (!self || !stream)
+    if (!self || !buf || !add)
     {
         _DBG ("Bad arguments.");
         return true;
@@ -129,11 +124,9 @@ bool
     for (p = (struct target_name_entry_t *) self->list.first; p;
          p = (struct target_name_entry_t *) p->list_entry.next)
     {
-        if (fprintf (stream, padding ? " %s" : "%s", p->name) < 0)
-        {
-            _perror ("fprintf");
-            return true;
-        }
+        if ((padding && strbuf_add_char (buf, ' '))
+        ||  add (buf, p->name))
+            return true;        // Fail
         padding = true;
     }
 
@@ -179,15 +172,6 @@ void
         struct target_names_t *self
     )
 {
-    struct target_name_entry_t *p, *n;
-
-    p = (struct target_name_entry_t *) self->list.first;
-    while (p)
-    {
-        n = (struct target_name_entry_t *) p->list_entry.next;
-        target_name_entry_free (p);
-        free (p);
-        p = n;
-    }
+    arena_free (&self->arena);
     target_names_clear (self);
 }
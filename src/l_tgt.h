@@ -9,8 +9,9 @@
 #include "defs.h"
 
 #include <stdbool.h>
-#include <stdio.h>
+#include "arena.h"
 #include "l_list.h"
+#include "strbuf.h"
 
 // Target names list structure
 
@@ -19,7 +20,7 @@
 struct target_name_entry_t
 {
     struct list_entry_t list_entry;
-    char *name;
+    const char *name;   // interned
 };
 
 void
@@ -39,6 +40,7 @@ void
 struct target_names_t
 {
     struct list_t list;
+    struct arena_t arena;       // entries
 };
 
 void
@@ -57,11 +59,13 @@ bool
     );
 
 // Returns "false" on success.
+// Appends space-separated list to "buf". Every name is added by "add".
 bool
     target_names_print
     (
         struct target_names_t *self,
-        FILE *stream
+        struct strbuf_t *buf,
+        strbuf_add_proc_t *add
     );
 
 #if DEBUG == 1
@@ -21,6 +21,8 @@
 #include <ctype.h>
 #include "asmfile.h"
 #include "debug.h"
+#include "intern.h"
+#include "l_cache.h"
 #include "l_err.h"
 #include "l_ifile.h"
 #include "l_inc.h"
@@ -31,6 +33,12 @@
 #include "l_tgt.h"
 #include "parser.h"
 #include "platform.h"
+#include "probe.h"
+#include "server.h"
+#include "stats.h"
+#include "strbuf.h"
+#include "trace.h"
+#include "workers.h"
 
 #define PROGRAM_NAME "aspp"
 
@@ -59,6 +67,9 @@
 #define ACT_PREPROCESS 2
 #define ACT_MAKE_RULE  3
 
+#define DEPS_FORMAT_MAKE  0
+#define DEPS_FORMAT_NINJA 1
+
 // Variables
 
 struct errors_t
@@ -74,12 +85,29 @@ struct include_paths_t
 struct input_sources_t
           v_input_sources  = { { .first = NULL, .last = NULL, .count = 0 } };
 struct sources_t
-          v_sources        = { { .first = NULL, .last = NULL, .count = 0 } };
+          v_sources        = { { .first = NULL, .last = NULL, .count = 0 },
+                               { .buckets = NULL, .size = 0, .count = 0 } };
 struct target_names_t
           v_target_names   = { { .first = NULL, .last = NULL, .count = 0 } };
-char     *v_output_name;
-struct prerequisites_t
-          v_prerequisites  = { { .first = NULL, .last = NULL, .count = 0 } };
+char     *v_output_name    = NULL;
+bool      v_output_md      = false;             // "-MD": output name is made of target name
+unsigned  v_deps_format    = DEPS_FORMAT_MAKE;
+char     *v_batch_name     = NULL;              // "--batch": all rules are written here
+const char
+         *v_batch_target   = "%.o";             // "--batch-target" pattern
+const char
+         *v_batch_ext      = ".asm";            // "--batch-ext"
+unsigned  v_rule_mark      = 0;
+char     *v_cache_name     = NULL;
+struct scan_cache_t
+          v_cache          = { { .first = NULL, .last = NULL, .count = 0 },
+                               { .buckets = NULL, .size = 0, .count = 0 }, false };
+struct scan_cache_t
+          v_server_caches[SYNTAX_COUNT];        // indexed by syntax
+struct scan_cache_t
+         *v_scan_cache     = NULL;              // cache in use (if any)
+bool      v_server         = false;
+unsigned  v_jobs           = 1;                 // number of scanning threads
 
 #if DEBUG == 1
 void _DBG_dump_vars (void)
@@ -88,9 +116,7 @@ void _DBG_dump_vars (void)
     _DBG_ ("Input files syntax = '%s'", _syntax_to_str (v_syntax, &s) ? s : "unknown");
     _DBG_include_paths_dump (&v_include_paths);
     _DBG_input_sources_dump (&v_input_sources);
-    _DBG_target_names_dump (&v_target_names);
-    _DBG_ ("Output file name = '%s'", v_output_name);
-
+    _DBG_ ("Cache file name = '%s'", v_cache_name);
 }
 #else   // DEBUG != 1
 #define _DBG_dump_vars(x)
@@ -142,6 +168,24 @@ void error_exit (const char *format, ...)
     exit (EXIT_FAILURE);
 }
 
+// Statistics are printed once: when "run" returns (server's child exits
+// without calling "atexit" handlers) or on exit.
+void print_stats (void)
+{
+    if (stats_enabled)
+    {
+        stats_print (stderr);
+        stats_enabled = false;
+    }
+}
+
+// Trace is saved once like statistics.
+void save_trace (void)
+{
+    if (trace_enabled && !trace_save ())
+        fprintf (stderr, "Failed to write trace file." NL);
+}
+
 void show_title (void)
 {
     fprintf (stdout,
@@ -172,9 +216,45 @@ NL
 "-M[M]           output autodepend make rule" NL
 "-MF <file>      autodepend output name" NL
 "-MT <target>    autodepend target name (can be specified multiple times)" NL
+"-MD             same as -M with output name made of the first target name" NL
+"                with its extension replaced by \".d\" (if -MF is not given)" NL
+NL
+"Several input files may be given; each one gets its own rule made of the" NL
+"-MF and -MT options preceding it (trailing options belong to the last file)." NL
+NL
+"Source files of 64 KiB and larger are mapped into memory: a file truncated" NL
+"while being scanned is reported as failed or may crash the program." NL
 NL
 "Other options:" NL
-"--syntax <syntax>   select source file syntax (tasm, sjasm)" NL,
+"--syntax <syntax>   select source file syntax (tasm, sjasm)" NL
+"--cache <file>      keep scan results of unchanged files in a cache file" NL
+"-j <jobs>           load, parse and resolve files using this number of threads" NL
+"--dir-cache         read include directories once and look files up in" NL
+"                    their listings" NL
+"--deps-format <fmt> autodepend output format (make, ninja - a single rule" NL
+"                    of a single target with spaces, '#' and '$' escaped as" NL
+"                    by GCC)" NL
+"--stats             print counters and times of processing phases to stderr" NL
+"                    on exit" NL
+"--trace <file>      write spans of processed files as Chrome trace events" NL
+"                    (JSON) to be viewed by Perfetto" NL
+NL
+"Batch mode (one process and one makefile for a whole tree):" NL
+"--batch <file>      write rules of all input files to a single file" NL
+"--batch-target <pattern>" NL
+"                    target name of input files without -MT ('%%' is file" NL
+"                    name without extension, default is \"%%.o\")" NL
+"--batch-ext <ext>   extension of files found in directories for following" NL
+"                    --batch-sources options (default is \".asm\")" NL
+"--batch-sources <path>" NL
+"                    add input files from a directory tree or a list file" NL
+"                    (one name per line)" NL
+NL
+"Server mode (must be the first option):" NL
+"--server <socket>   serve requests on a local socket keeping scan results" NL
+"                    in memory" NL
+"--client <socket>   forward the rest of command line to a server (it is" NL
+"                    processed locally if the server is not available)" NL,
         PROGRAM_NAME
     );
 }
@@ -194,17 +274,59 @@ char *_make_path (const char *a, const char *b)
     return result;
 }
 
-// Returns "true" on success.
-bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned inc_flags)
+// Returns "false" on success ("result" if presents is set to list entry).
+// Every real file is added only once so it is scanned only once.
+bool add_source (const char *real, const char *base, const char *user, unsigned flags,
+    struct source_entry_t **result)
+{
+    struct source_entry_t *p;
+
+    if (!sources_find_real (&v_sources, real, &p))
+    {
+        // HINT: This is weird if we included this file as binary but now we want to parse it
+        if ((flags & SRCFL_PARSE) && !(p->flags & SRCFL_PARSE))
+            p->flags |= SRCFL_PARSE;
+        if (result)
+            *result = p;
+        return false;
+    }
+
+    return sources_add (&v_sources, real, base, user, flags, result);
+}
+
+// Included file resolved by a worker thread (see "add_source")
+struct resolved_file_t
+{
+    const char *real, *base, *user;     // interned
+    unsigned flags;
+};
+
+// Returns "false" on success.
+bool set_resolved_file (struct resolved_file_t *self, const char *real, const char *base,
+    const char *user, unsigned flags)
+{
+    self->real = intern_str (real);
+    self->base = intern_str (base);
+    self->user = intern_str (user);
+    self->flags = flags;
+    return !self->real || !self->base || !self->user;
+}
+
+// Returns "true" on success ("result" is set to the file to add as a source).
+// Called by worker threads: only probes and interned strings are shared here.
+bool resolve_included_file (struct source_entry_t *src, const char *f_loc, unsigned inc_flags,
+    struct resolved_file_t *result)
 {
     bool ok;
     char *tmp;
     char *src_base;
     char *src_base_tmp;
-    char *inc_real, *inc_base, *inc_user;
+    const char *inc_real, *inc_base, *inc_user;
     char *inc_real_tmp, *inc_base_tmp, *inc_user_tmp;
     char *inc_real_res;
+    char *inc_dir_tmp;  // real directory of primary source file
     struct include_path_entry_t *resolved;
+    struct trace_span_t span;
 
     _DBG_ ("Source user file = '%s'", src->user);
     _DBG_ ("Source base path = '%s'", src->base);
@@ -212,12 +334,14 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
     _DBG_ ("Include file = '%s'", f_loc);
     _DBG_ ("Include flags = 0x%X", inc_flags);
 
+    trace_begin (&span);
     ok = false;
     src_base_tmp = (char *) NULL;
     inc_real_tmp = (char *) NULL;
     inc_base_tmp = (char *) NULL;
     inc_user_tmp = (char *) NULL;
     inc_real_res = (char *) NULL;
+    inc_dir_tmp = (char *) NULL;
 
     inc_user = f_loc;
     if (check_path_abs (f_loc))
@@ -234,10 +358,10 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
         inc_base = inc_base_tmp;
         if (!check_file_exists (f_loc))
             inc_flags &= ~SRCFL_PARSE;
-        if (sources_add (&v_sources, inc_real, inc_base, inc_user, inc_flags, NULL))
+        if (set_resolved_file (result, inc_real, inc_base, inc_user, inc_flags))
         {
             // Fail
-            _perror ("sources_add");
+            _perror ("set_resolved_file");
             goto _local_exit;
         }
         // Success
@@ -257,7 +381,7 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
         if (check_path_abs (src->user))
         {
             // Absolute path of primary source file
-            tmp = _make_path (src_base, src->user);
+            tmp = _make_path (src_base, f_loc);
             if (!tmp)
             {
                 // Fail
@@ -278,15 +402,14 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
         else
         {
             // Relative path of primary source file
-            tmp = get_dir_name (src->real);
-            if (!tmp)
+            inc_dir_tmp = get_dir_name (src->real);
+            if (!inc_dir_tmp)
             {
                 // Fail
                 _perror ("get_dir_name");
                 goto _local_exit;
             }
-            inc_real_tmp = _make_path (tmp, f_loc);
-            free (tmp);
+            inc_real_tmp = _make_path (inc_dir_tmp, f_loc);
             if (!inc_real_tmp)
             {
                 // Fail
@@ -316,12 +439,13 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
                 inc_user = inc_user_tmp;
             }
         }
-        if (check_file_exists (inc_real))
+        // "inc_real" is resolved already (probe it relative to source's directory if known)
+        if (probe_is_file_at (inc_real, inc_dir_tmp ? probe_dir_fd (inc_dir_tmp) : -1, f_loc))
         {
-            if (sources_add (&v_sources, inc_real, inc_base, inc_user, inc_flags, NULL))
+            if (set_resolved_file (result, inc_real, inc_base, inc_user, inc_flags))
             {
                 // Fail
-                _perror ("sources_add");
+                _perror ("set_resolved_file");
                 goto _local_exit;
             }
             // Success
@@ -354,10 +478,10 @@ bool process_included_file (struct source_entry_t *src, char *f_loc, unsigned in
             {
                 inc_flags = 0;
             }
-            if (sources_add (&v_sources, inc_real, inc_base, inc_user, 0, NULL))
+            if (set_resolved_file (result, inc_real, inc_base, inc_user, inc_flags))
             {
                 // Fail
-                _perror ("sources_add");
+                _perror ("set_resolved_file");
                 goto _local_exit;
             }
             // Success
@@ -376,81 +500,136 @@ _local_exit:
         free (inc_user_tmp);
     if (inc_real_res)
         free (inc_real_res);
+    if (inc_dir_tmp)
+        free (inc_dir_tmp);
 
+    trace_end (&span, "resolve_included_file", ok ? result->real : f_loc, -1, -1);
     _DBG_ ("Done checking '%s' (%s).", f_loc, ok ? "success" : "failed");
     return ok;
 }
 
+// Scan job (loading and parsing of a single source, may be run by a worker thread)
+
+struct scan_job_t
+{
+    struct worker_job_t job;
+    struct scan_job_t *next;
+    struct source_entry_t *src;
+    struct scan_cache_entry_t *cached;  // found before job is started
+    bool cache;         // "size" and "mtime" are valid and must be cached
+    bool hit;           // included files are taken from "cached"
+    unsigned long long size;
+    long long mtime;
+    long bytes;         // loaded (-1 if not loaded)
+    struct resolved_file_t *resolved;   // of included files (in list order)
+    bool failed;
+};
+
 // Returns "false" on success.
-bool collect_included_files (struct source_entry_t *src)
+// Only "job" and its source's included files list are changed here.
+bool collect_included_files (struct scan_job_t *job)
 {
     bool ok;
+    struct source_entry_t *src;
     struct asm_file_t file;
-    char *t;
     const char *s;
-    unsigned tl, len;
+    unsigned len;
     unsigned inc_flags;
-    char *inc_name;
+    const char *inc_name;
+    unsigned inc_len;
     get_include_proc_t *getincl;
+    const char *const *keys;
     char st;
     struct included_file_entry_t *incl;
+    struct scan_cache_entry_t *cached;
+    struct stats_timer_t timer;
+    unsigned long long lines, directives;
+    long long now;
+    struct trace_span_t span;
+
+    src = job->src;
 
     _DBG_ ("Source user file = '%s'", src->user);
     _DBG_ ("Source base path = '%s'", src->base);
     _DBG_ ("Source real file = '%s'", src->real);
 
+    trace_begin (&span);
     ok = false;
+    lines = 0;
+    directives = 0;
+    job->bytes = -1;
 
     // Free on exit (_local_exit):
     asm_file_clear (&file);
-    t = (char *) NULL;
 
-    if (!_find_get_include_proc (v_syntax, &getincl))
+    if (!_find_get_include_proc (v_syntax, &getincl)
+    ||  !_find_get_include_keys (v_syntax, &keys))
     {
         // Fail
         _DBG ("Unknown syntax specified.");
         goto _local_exit;
     }
 
-    if (!asm_file_load (&file, src->user))
-    {
-        // Fail
-        goto _local_exit;
-    }
-
-    tl = 0;
-    while (asm_file_next_line (&file, &s, &len))
+    // Take included files list from cache if the file was not changed since last run
+    job->cache = false;
+    cached = job->cached;
+    if (v_scan_cache)
     {
-        // Free on exit (_loop_exit):
-        inc_name = (char *) NULL;
-
-        if (tl < len + 1)
+        // Files watched by server are known to be unchanged (unless their paths were changed)
+        if (cached && cached->watch == SCAN_CACHE_STALE)
+            cached = (struct scan_cache_entry_t *) NULL;
+        if (!cached || cached->watch < 0)
         {
-            tl = len + 1;       // + terminating zero
-            if (t)
-                free (t);
-            t = malloc (tl);
-            if (!t)
+            job->cache = get_current_time (&now)
+                      && get_file_info (src->real, &job->size, &job->mtime);
+            if (cached && (!job->cache || cached->size != job->size || cached->mtime != job->mtime))
+                cached = (struct scan_cache_entry_t *) NULL;
+            // A file changed just before its scan may be changed again unnoticed
+            if (job->cache && job->mtime > now - SCAN_CACHE_RACY_TIME)
             {
-                // Fail
-                _perror ("malloc");
-                goto _loop_exit;
+                _DBG_ ("File '%s' is too new to be cached.", src->real);
+                job->cache = false;
             }
         }
-        memcpy (t, s, len);
-        t[len] = '\0';
+    }
+    if (cached)
+    {
+        _DBG_ ("Using cached included files of '%s'.", src->real);
+        if (included_files_append (&src->included, &cached->included))
+            goto _local_exit;   // Fail
+        job->cache = false;
+        job->hit = true;
+        ok = true;
+        goto _local_exit;
+    }
 
-        st = getincl (t, &inc_flags, &inc_name);
+    stats_begin (&timer);
+    if (!asm_file_load (&file, src->real))
+    {
+        // Fail
+        goto _local_exit;
+    }
+    job->bytes = file.size;
+    stats_end (&timer, STATS_PHASE_LOAD);
+
+    // Lines and included file names are used in place - nothing is copied unless recorded
+    // Only lines containing a directive name are parsed
+    stats_begin (&timer);
+    while (asm_file_next_line_with (&file, keys, &s, &len))
+    {
+        lines++;
+        st = getincl (s, len, &inc_flags, &inc_name, &inc_len);
 
         switch (st)
         {
         case PARST_OK:
-            if (included_files_find (&src->included, inc_name, &incl))
+            directives++;
+            if (included_files_find (&src->included, inc_name, inc_len, &incl))
             {
-                if (included_files_add (&src->included, file.line, inc_flags, inc_name, NULL))
+                if (included_files_add (&src->included, asm_file_line (&file), inc_flags, inc_name, inc_len, NULL))
                 {
                     // Fail
-                    goto _loop_exit;
+                    goto _local_exit;
                 }
             }
             else
@@ -459,76 +638,172 @@ bool collect_included_files (struct source_entry_t *src)
                 if ((inc_flags & SRCFL_PARSE) && !(incl->flags & SRCFL_PARSE))
                     incl->flags |= SRCFL_PARSE;
             }
-
-            if (inc_name)
-                free (inc_name);
-            inc_name = (char *) NULL;
             break;
         case PARST_SKIP:
-            goto _skip_line;
+            break;
         default:
             // Error
-            goto _loop_exit;
+            goto _local_exit;
         }
-    _skip_line:;
+    }
+    stats_end (&timer, STATS_PHASE_SCAN);
+
+    // Prefiltered lines are compared to all of them (not timed)
+    if (stats_enabled)
+        stats_add (STAT_LINES_SCANNED, asm_file_count_lines (&file));
+
+    if (!asm_file_check (&file))
+    {
+        // Fail
+        _DBG_ ("File '%s' was truncated while being scanned.", src->real);
+        goto _local_exit;
     }
 
     ok = true;
-    goto _local_exit;
 
-_loop_exit:
-    if (inc_name)
-        free (inc_name);
 _local_exit:
+    stats_add (STAT_LINES_PARSED, lines);
+    stats_add (STAT_DIRECTIVES, directives);
     asm_file_free (&file);
-    if (t)
-        free (t);
+    trace_end (&span, "collect_included_files", src->real, job->bytes, src->included.list.count);
     _DBG_ ("Done collecting included files of '%s' (%s).", src->user, ok ? "success" : "failed");
     return !ok;
 }
 
 // Returns "false" on success.
-bool process_included_files_list (struct source_entry_t *src)
+// Resolves included files of a scanned source (by a worker thread too).
+bool resolve_included_files_list (struct scan_job_t *job)
 {
     bool ok;
+    struct source_entry_t *src;
     struct included_file_entry_t *p;
+    struct resolved_file_t *r;
+    struct stats_timer_t timer;
+
+    src = job->src;
+    if (!src->included.list.count)
+        return false;   // Success (nothing to do)
 
+    stats_begin (&timer);
     ok = false;
 
-    p = (struct included_file_entry_t *) src->included.list.first;
-    while (p)
+    job->resolved = malloc (src->included.list.count * sizeof (struct resolved_file_t));
+    if (!job->resolved)
     {
-        if (!process_included_file (src, p->name, p->flags))
+        // Fail
+        _perror ("malloc");
+        goto _local_exit;
+    }
+
+    for (p = (struct included_file_entry_t *) src->included.list.first, r = job->resolved; p;
+         p = (struct included_file_entry_t *) p->list_entry.next, r++)
+    {
+        if (!resolve_included_file (src, p->name, p->flags, r))
         {
             // Fail
             goto _local_exit;
         }
-        p = (struct included_file_entry_t *) p->list_entry.next;
     }
 
     ok = true;
 
 _local_exit:
-    _DBG_ ("Done parsing included files of '%s' (%s).", src->user, ok ? "success" : "failed");
+    stats_end (&timer, STATS_PHASE_RESOLVE);
+    _DBG_ ("Done resolving included files of '%s' (%s).", src->user, ok ? "success" : "failed");
     return !ok;
 }
 
 // Returns "false" on success.
-bool parse_source (struct source_entry_t *src)
+// Adds resolved included files of a source to the sources list (by main thread).
+bool process_included_files_list (struct scan_job_t *job)
+{
+    struct included_file_entry_t *p;
+    const struct resolved_file_t *r;
+
+    for (p = (struct included_file_entry_t *) job->src->included.list.first, r = job->resolved; p;
+         p = (struct included_file_entry_t *) p->list_entry.next, r++)
+    {
+        if (add_source (r->real, r->base, r->user, r->flags, &p->source))
+        {
+            // Fail
+            _perror ("add_source");
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void scan_job_run (struct worker_job_t *job)
+{
+    struct scan_job_t *p;
+
+    p = (struct scan_job_t *) job;
+    p->failed = collect_included_files (p) || resolve_included_files_list (p);
+}
+
+// Returns new job on success and "NULL" on fail.
+struct scan_job_t *scan_job_new (struct source_entry_t *src)
+{
+    struct scan_job_t *job;
+
+    job = malloc (sizeof (struct scan_job_t));
+    if (!job)
+    {
+        // Fail
+        _perror ("malloc");
+        return NULL;
+    }
+    job->next = (struct scan_job_t *) NULL;
+    job->src = src;
+    // The cache is looked up here because it is changed by main thread only
+    job->cached = (struct scan_cache_entry_t *) NULL;
+    if (v_scan_cache)
+        scan_cache_find (v_scan_cache, src->real, &job->cached);
+    job->cache = false;
+    job->hit = false;
+    job->bytes = -1;
+    job->resolved = (struct resolved_file_t *) NULL;
+    job->failed = false;
+    return job;
+}
+
+void scan_job_free (struct scan_job_t *job)
+{
+    if (job->resolved)
+        free (job->resolved);
+    free (job);
+}
+
+// Returns "false" on success.
+// Completes the scan job of a source: adds its resolved included files which may be new sources.
+bool parse_source (struct scan_job_t *job)
 {
     bool ok;
+    struct source_entry_t *src;
+    struct trace_span_t span;
 
+    trace_begin (&span);
     ok = false;
+    src = job->src;
+
+    if (job->failed)
+    {
+        // Fail
+        goto _local_exit;
+    }
 
-    if (collect_included_files (src))
+    if (job->cache && scan_cache_update (v_scan_cache, src->real, job->size, job->mtime, &src->included, NULL))
     {
         // Fail
         goto _local_exit;
     }
+    if (job->hit)
+        job->cached->seen = true;
 
     _DBG_ ("Found %u included files.", src->included.list.count);
 
-    if (src->included.list.count && process_included_files_list (src))
+    if (process_included_files_list (job))
     {
         // Fail
         goto _local_exit;
@@ -537,98 +812,445 @@ bool parse_source (struct source_entry_t *src)
     ok = true;
 
 _local_exit:
+    trace_end (&span, "parse_source", src->real, job->bytes, src->included.list.count);
     _DBG_ ("Done parsing '%s' (%s).", src->user, ok ? "success" : "failed");
     return !ok;
 }
 
 // Returns "false" on success.
-bool make_rule (void)
+// Scans all input sources and everything they include into one shared list.
+// Sources are loaded, parsed and their included files are resolved by worker
+// threads ahead of time, but their results are taken strictly in list order,
+// so the list (and so the rules) are the same for any number of threads.
+bool scan_sources (void)
 {
+    bool ok;
     struct input_source_entry_t *isrc;
-    struct source_entry_t *src, *last;
+    struct source_entry_t *src, *queued;
+    struct workers_t workers;
+    struct scan_job_t *first, *last, *job;
 
     for (isrc = (struct input_source_entry_t *) v_input_sources.list.first; isrc;
          isrc = (struct input_source_entry_t *) isrc->list_entry.next)
     {
-        if (sources_add (&v_sources, isrc->real, isrc->base, isrc->user, SRCFL_PARSE, NULL))
+        if (add_source (isrc->real, isrc->base, isrc->user, SRCFL_PARSE, NULL))
             return true;        // Fail
     }
 
-    if (v_sources.list.count)
+    if (workers_start (&workers, v_jobs > 1 ? v_jobs : 0, scan_job_run))
+        return true;    // Fail
+
+    ok = false;
+    queued = (struct source_entry_t *) NULL;    // last source seen by queue
+    first = (struct scan_job_t *) NULL;
+    last = (struct scan_job_t *) NULL;
+
+    // New sources are appended to the list while we walk through it
+    for (src = (struct source_entry_t *) v_sources.list.first; src;
+         src = (struct source_entry_t *) src->list_entry.next)
     {
-        src  = (struct source_entry_t *) v_sources.list.first;
-        last = (struct source_entry_t *) v_sources.list.last;
-        while (src != (struct source_entry_t *) last->list_entry.next)
+        // Queue all known sources to be parsed
+        while (queued != (struct source_entry_t *) v_sources.list.last)
         {
-            while (src != (struct source_entry_t *) last->list_entry.next)
+            queued = queued ? (struct source_entry_t *) queued->list_entry.next
+                            : (struct source_entry_t *) v_sources.list.first;
+            if (queued->flags & SRCFL_PARSE)
             {
-                if (src->flags & SRCFL_PARSE)
-                {
-                    if (!parse_source (src))
-                    {
-                        if (prerequisites_add (&v_prerequisites, src->user, NULL))
-                            return true;        // Fail
-                    }
-                    else
-                    {
-                        show_errors ();
-                        exit_on_errors ();
-                    }
-                }
+                job = scan_job_new (queued);
+                if (!job)
+                    goto _local_exit;   // Fail
+                if (last)
+                    last->next = job;
                 else
-                {
-                    if (prerequisites_add (&v_prerequisites, src->user, NULL))
-                        return true;    // Fail
-                }
-                src = (struct source_entry_t *) src->list_entry.next;
+                    first = job;
+                last = job;
+                workers_submit (&workers, &job->job);
+            }
+        }
+
+        if (src->flags & SRCFL_PARSE)
+        {
+            if (first && first->src == src)
+            {
+                job = first;
+                first = job->next;
+                if (!first)
+                    last = (struct scan_job_t *) NULL;
+                workers_wait (&workers, &job->job);
+            }
+            else
+            {
+                // Source was marked for parsing after it was seen by queue
+                job = scan_job_new (src);
+                if (!job)
+                    goto _local_exit;   // Fail
+                scan_job_run (&job->job);
             }
-            src = (struct source_entry_t *) last->list_entry.next;
-            last = (struct source_entry_t *) v_sources.list.last;
+            if (parse_source (job))
+            {
+                src->flags |= SRCFL_FAIL;
+                show_errors ();
+                if (errors.list.count)
+                    workers_stop (&workers);
+                exit_on_errors ();
+            }
+            scan_job_free (job);
         }
     }
 
-    return false;       // Success
+    ok = true;
+
+_local_exit:
+    workers_stop (&workers);
+    while (first)
+    {
+        job = first->next;
+        scan_job_free (first);
+        first = job;
+    }
+    return !ok;
 }
 
 // Returns "false" on success.
-bool write_rule (const char *name)
+// Collects prerequisites of a single input source in the order they were found.
+bool make_rule (struct input_source_entry_t *isrc, struct prerequisites_t *prerequisites)
 {
-    FILE *f;
+    bool ok;
+    struct source_entry_t **queue, *src;
+    struct included_file_entry_t *p;
+    unsigned head, tail;
+
+    ok = false;
+    queue = (struct source_entry_t **) NULL;
+
+    if (sources_find_real (&v_sources, isrc->real, &src))
+    {
+        // Fail
+        _DBG_ ("Input source '%s' was not scanned.", isrc->user);
+        goto _local_exit;
+    }
 
-    f = fopen (name, "w");
-    if (!f)
+    queue = malloc (v_sources.list.count * sizeof (struct source_entry_t *));
+    if (!queue)
     {
         // Fail
-        _perror ("fopen");
+        _perror ("malloc");
+        goto _local_exit;
+    }
+
+    v_rule_mark++;
+    src->mark = v_rule_mark;
+    head = 0;
+    tail = 0;
+    queue[tail++] = src;
+    while (head < tail)
+    {
+        src = queue[head++];
+        if (src->flags & SRCFL_FAIL)
+            continue;
+        if (prerequisites_add (prerequisites, src->user, NULL))
+            goto _local_exit;   // Fail
+        for (p = (struct included_file_entry_t *) src->included.list.first; p;
+             p = (struct included_file_entry_t *) p->list_entry.next)
+        {
+            if (p->source && p->source->mark != v_rule_mark)
+            {
+                p->source->mark = v_rule_mark;
+                queue[tail++] = p->source;
+            }
+        }
+    }
+
+    ok = true;
+
+_local_exit:
+    if (queue)
+        free (queue);
+    return !ok;
+}
+
+// Returns "false" on success.
+// Adds a file name escaped the way GCC does it in dependency files (which is
+// understood by both make and Ninja): spaces and '#' are prefixed with a
+// backslash (doubling backslashes before them) and '$' is doubled.
+bool add_escaped_name (struct strbuf_t *buf, const char *s)
+{
+    const char *p, *q;
+
+    for (p = s; *p; p++)
+    {
+        switch (*p)
+        {
+        case ' ':
+        case '\t':
+        case '#':
+            for (q = p; q > s && q[-1] == '\\'; q--)
+                if (strbuf_add_char (buf, '\\'))
+                    return true;        // Fail
+            if (strbuf_add_char (buf, '\\'))
+                return true;    // Fail
+            break;
+        case '$':
+            if (strbuf_add_char (buf, '$'))
+                return true;    // Fail
+            break;
+        case '\n':
+        case '\r':
+            _DBG_ ("File name '%s' can not be escaped.", s);
+            return true;        // Fail
+        default:
+            break;
+        }
+        if (strbuf_add_char (buf, *p))
+            return true;        // Fail
+    }
+
+    return false;
+}
+
+// Returns "false" on success.
+// Appends a rule to "buf".
+bool add_rule (struct strbuf_t *buf, struct target_names_t *targets,
+    struct prerequisites_t *prerequisites)
+{
+    strbuf_add_proc_t *add;
+
+    add = v_deps_format == DEPS_FORMAT_NINJA ? add_escaped_name : strbuf_add_str;
+
+    return target_names_print (targets, buf, add)
+        || strbuf_add_str (buf, ": ")
+        || prerequisites_print (prerequisites, buf, add)
+        || strbuf_add_str (buf, NL);
+}
+
+// Returns "false" on success.
+// File is rewritten only if it differs, so unchanged rules keep its
+// modification time.
+bool write_rules (const char *name, struct strbuf_t *rules)
+{
+    if (!write_file_if_changed (name, rules->data, rules->len, NULL))
+    {
+        // Fail
+        _perror ("write_file_if_changed");
         return true;
     }
 
-    if (target_names_print (&v_target_names, f))
-        return true;    // Fail
+    return false;       // Success
+}
 
-    if (fprintf (f, ": ") < 0)
-        return true;    // Fail
+// Returns "false" on success.
+// Moves pending "-MF" and "-MT" options to the rule of an input source.
+bool attach_rule_options (struct input_source_entry_t *isrc)
+{
+    const struct target_name_entry_t *p;
 
-    if (prerequisites_print (&v_prerequisites, f))
-        return true;    // Fail
+    for (p = (struct target_name_entry_t *) v_target_names.list.first; p;
+         p = (struct target_name_entry_t *) p->list_entry.next)
+    {
+        if (target_names_add (&isrc->targets, p->name, NULL))
+            return true;        // Fail
+    }
+    target_names_free (&v_target_names);
 
-    if (fprintf (f, NL) < 0)
-        return true;    // Fail
+    if (v_output_name)
+    {
+        if (input_source_entry_set_output (isrc, v_output_name))
+            return true;        // Fail
+        v_output_name = NULL;
+    }
+
+    return false;       // Success
+}
+
+// Returns extension of file "name" (starting with '.') or its end if there
+// is none.
+const char *find_file_ext (const char *name)
+{
+    const char *ext, *p;
+
+    ext = NULL;
+    for (p = name; *p; p++)
+    {
+        if (*p == '.')
+            ext = p;
+        else if (*p == '/' || *p == '\\')
+            ext = NULL;
+    }
+    if (!ext || ext == name || ext[-1] == '/' || ext[-1] == '\\')
+        ext = p;        // no extension (or a hidden file name)
+    return ext;
+}
 
-    fclose (f);
+// Returns "false" on success.
+// Sets output name of an input source to its first target name with
+// extension replaced by ".d" ("-MD" option).
+bool set_md_output (struct input_source_entry_t *isrc)
+{
+    const char *target, *ext;
+    char *name;
+    bool status;
+
+    target = ((struct target_name_entry_t *) isrc->targets.list.first)->name;
+    ext = find_file_ext (target);
+
+    name = malloc (ext - target + 2 + 1);
+    if (!name)
+    {
+        _perror ("malloc");
+        return true;
+    }
+    memcpy (name, target, ext - target);
+    strcpy (name + (ext - target), ".d");
+
+    status = input_source_entry_set_output (isrc, name);
+    free (name);
+    return status;
+}
 
+// Returns "false" on success.
+// Adds a target to an input source by "--batch-target" pattern: every '%' is
+// replaced with source's name without extension.
+bool set_batch_target (struct input_source_entry_t *isrc)
+{
+    bool ok;
+    struct strbuf_t name;
+    const char *p, *ext;
+
+    ok = false;
+    strbuf_clear (&name);
+
+    ext = find_file_ext (isrc->user);
+    for (p = v_batch_target; *p; p++)
+    {
+        if (*p == '%' ? strbuf_add (&name, isrc->user, ext - isrc->user)
+                      : strbuf_add_char (&name, *p))
+            goto _local_exit;   // Fail
+    }
+    if (strbuf_add_char (&name, '\0'))
+        goto _local_exit;       // Fail
+
+    if (target_names_add (&isrc->targets, name.data, NULL))
+        goto _local_exit;       // Fail
+
+    ok = true;
+
+_local_exit:
+    strbuf_free (&name);
+    return !ok;
+}
+
+// Returns "false" on success.
+bool add_batch_source (const char *path, void *arg)
+{
+    char *tmp, *real;
+    bool found;
+
+    // A file found twice (by a directory and a list file) is added once
+    tmp = check_path_abs (path) ? strdup (path) : _make_path (v_base_path_real, path);
+    real = tmp ? resolve_full_path (tmp) : (char *) NULL;
+    if (tmp)
+        free (tmp);
+    if (!real)
+    {
+        // Fail
+        _perror ("resolve_full_path");
+        return add_error ("Input source file '%s' was not found.", path);
+    }
+    found = !input_sources_find_real (&v_input_sources, real, NULL);
+    free (real);
+    if (found)
+    {
+        _DBG_ ("Input source file '%s' is already added.", path);
+        return false;   // Success
+    }
+
+    if (input_sources_add_with_check (&v_input_sources, path, v_base_path_real, NULL))
+    {
+        // Fail
+        _DBG_ ("Input source file '%s' was not found.", path);
+        return add_error ("Input source file '%s' was not found.", path);
+    }
     return false;       // Success
 }
 
-int main (int argc, char **argv)
+// Returns "false" on success.
+// Adds input sources from a directory tree (files ending with "--batch-ext")
+// or from a list file (one name per line, empty lines and lines starting
+// with '#' are skipped).
+bool add_batch_sources (const char *path)
 {
-    unsigned i;
+    bool ok;
+    struct asm_file_t file;
+    const char *s;
+    unsigned len;
+    char *name;
 
-    setlocale (LC_CTYPE, "C");
+    if (walk_dir (path, v_batch_ext, add_batch_source, NULL))
+        return false;   // Success
+    if (errno != ENOTDIR)
+    {
+        // Fail
+        _perror ("walk_dir");
+        return add_error ("Failed to read directory '%s'.", path);
+    }
+
+    ok = false;
+    asm_file_clear (&file);
+    name = (char *) NULL;
+
+    if (!asm_file_load (&file, path))
+    {
+        // Fail
+        asm_file_free (&file);
+        return add_error ("Failed to read list file '%s'.", path);
+    }
+
+    while (asm_file_next_line (&file, &s, &len))
+    {
+        while (len && (s[len - 1] == ' ' || s[len - 1] == '\t'))
+            len--;
+        if (!len || s[0] == '#')
+            continue;
+        name = malloc (len + 1);
+        if (!name)
+        {
+            // Fail
+            _perror ("malloc");
+            goto _local_exit;
+        }
+        memcpy (name, s, len);
+        name[len] = '\0';
+        if (add_batch_source (name, NULL))
+            goto _local_exit;   // Fail
+        free (name);
+        name = (char *) NULL;
+    }
+
+    ok = true;
+
+_local_exit:
+    if (name)
+        free (name);
+    asm_file_free (&file);
+    return !ok;
+}
+
+int run (int argc, char **argv)
+{
+    unsigned i;
+    unsigned long n;
+    char *endp;
+    struct input_source_entry_t *isrc;
+    struct prerequisites_t prerequisites;
+    struct strbuf_t rules;
+    struct stats_timer_t timer;
+    const char *syntax;
 
     if (argc == 1)
         error_exit ("No parameters. %s" NL, HELP_HINT);
 
+    isrc = (struct input_source_entry_t *) NULL;
+
     v_base_path_real = get_current_dir ();
     if (!v_base_path_real)
         error_exit ("Failed to get current directory." NL);
@@ -667,6 +1289,12 @@ int main (int argc, char **argv)
             v_act_make_rule = 1;
             i++;
         }
+        else if (strcmp (argv[i], "-MD") == 0)
+        {
+            v_act_make_rule = 1;
+            v_output_md = true;
+            i++;
+        }
         else if (strcmp (argv[i], "-MF") == 0)
         {
             i++;
@@ -692,6 +1320,140 @@ int main (int argc, char **argv)
                 exit (EXIT_FAILURE);
             i++;
         }
+        else if (strcmp (argv[i], "--cache") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--cache", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            v_cache_name = argv[i];
+            i++;
+        }
+        else if (strcmp (argv[i], "-j") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("-j", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            n = strtoul (argv[i], &endp, 10);
+            if (endp == argv[i] || *endp != '\0' || !n || n > 1024)
+            {
+                if (add_error ("Bad number of jobs '%s' (#%u).", argv[i], i))
+                    exit (EXIT_FAILURE);
+            }
+            else
+                v_jobs = n;
+            i++;
+        }
+        else if (strcmp (argv[i], "--dir-cache") == 0)
+        {
+            v_include_paths.listed = true;
+            i++;
+        }
+        else if (strcmp (argv[i], "--stats") == 0)
+        {
+            if (!stats_enabled)
+            {
+                stats_start ();
+                atexit (print_stats);
+            }
+            i++;
+        }
+        else if (strcmp (argv[i], "--trace") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--trace", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            if (!trace_enabled)
+            {
+                trace_start (argv[i]);
+                atexit (save_trace);
+            }
+            i++;
+        }
+        else if (strcmp (argv[i], "--deps-format") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--deps-format", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            if (strcmp (argv[i], "make") == 0)
+                v_deps_format = DEPS_FORMAT_MAKE;
+            else if (strcmp (argv[i], "ninja") == 0)
+                v_deps_format = DEPS_FORMAT_NINJA;
+            else if (add_error ("Unknown dependency file format '%s' (#%u).", argv[i], i))
+                exit (EXIT_FAILURE);
+            i++;
+        }
+        else if (strcmp (argv[i], "--batch") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--batch", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            v_act_make_rule = 1;
+            v_batch_name = argv[i];
+            i++;
+        }
+        else if (strcmp (argv[i], "--batch-target") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--batch-target", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            if (!strchr (argv[i], '%'))
+            {
+                if (add_error ("Target name pattern '%s' has no '%%' (#%u).", argv[i], i))
+                    exit (EXIT_FAILURE);
+            }
+            else
+                v_batch_target = argv[i];
+            i++;
+        }
+        else if (strcmp (argv[i], "--batch-ext") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--batch-ext", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            v_batch_ext = argv[i];
+            i++;
+        }
+        else if (strcmp (argv[i], "--batch-sources") == 0)
+        {
+            i++;
+            if (i == argc)
+            {
+                if (add_missing_arg_error ("--batch-sources", i))
+                    exit (EXIT_FAILURE);
+                break;
+            }
+            if (add_batch_sources (argv[i]))
+                exit (EXIT_FAILURE);
+            i++;
+        }
         else if (strcmp (argv[i], "--syntax") == 0)
         {
             i++;
@@ -706,6 +1468,13 @@ int main (int argc, char **argv)
                     exit (EXIT_FAILURE);
             i++;
         }
+        else if (strcmp (argv[i], "--server") == 0
+             ||  strcmp (argv[i], "--client") == 0)
+        {
+            if (add_error ("Option '%s' must be the first one (#%u).", argv[i], i))
+                exit (EXIT_FAILURE);
+            i++;
+        }
         else if (argv[i][0] == '-')
         {
             if (add_error ("Unknown option '%s' (#%u).", argv[i], i))
@@ -714,20 +1483,18 @@ int main (int argc, char **argv)
         }
         else
         {
-            if (v_input_sources.list.count >= 1)
-            {
-                if (add_error ("Don't know what to do with input file '%s' (#%u).", argv[i], i))
-                    exit (EXIT_FAILURE);
-            }
-            else
-            {
-                if (input_sources_add_with_check (&v_input_sources, argv[i], v_base_path_real, NULL))
-                    error_exit ("Input source file '%s' was not found." NL, argv[i]);
-            }
+            if (input_sources_add_with_check (&v_input_sources, argv[i], v_base_path_real, &isrc))
+                error_exit ("Input source file '%s' was not found." NL, argv[i]);
+            if (attach_rule_options (isrc))
+                exit (EXIT_FAILURE);
             i++;
         }
     }
 
+    // Trailing "-MF" and "-MT" options belong to the last input source
+    if (isrc && attach_rule_options (isrc))
+        exit (EXIT_FAILURE);
+
     if (v_act_show_help)
     {
         if (v_act_preprocess + v_act_make_rule + v_include_paths.list.count + v_sources.list.count)
@@ -768,19 +1535,47 @@ int main (int argc, char **argv)
         show_help ();
         break;
     case ACT_MAKE_RULE:
-        if (!v_target_names.list.count)
+        for (isrc = (struct input_source_entry_t *) v_input_sources.list.first; isrc;
+             isrc = (struct input_source_entry_t *) isrc->list_entry.next)
         {
-            if (add_error ("No target name was specified."))
-                exit (EXIT_FAILURE);
+            if (!isrc->targets.list.count && v_batch_name)
+            {
+                if (set_batch_target (isrc))
+                    exit (EXIT_FAILURE);
+            }
+            if (!isrc->targets.list.count)
+            {
+                if (add_error ("No target name was specified for '%s'.", isrc->user))
+                    exit (EXIT_FAILURE);
+            }
+            if (v_batch_name)
+                continue;       // output name is not used
+            if ((!isrc->output || !strcmp (isrc->output, ""))
+            &&  v_output_md && isrc->targets.list.count)
+            {
+                if (set_md_output (isrc))
+                    exit (EXIT_FAILURE);
+            }
+            if (!isrc->output || !strcmp (isrc->output, ""))
+            {
+                if (add_error ("No output name was specified for '%s'.", isrc->user))
+                    exit (EXIT_FAILURE);
+            }
+            // Ninja before 1.10 rejects depfiles with several outputs
+            if (isrc->targets.list.count > 1 && v_deps_format == DEPS_FORMAT_NINJA)
+            {
+                if (add_error ("Ninja dependency file format allows a single target only (for '%s').", isrc->user))
+                    exit (EXIT_FAILURE);
+            }
         }
-        if (!v_output_name || !strcmp (v_output_name, ""))
+        if (!v_input_sources.list.count)
         {
-            if (add_error ("No output name was specified."))
+            if (add_error ("No source files were specified."))
                 exit (EXIT_FAILURE);
         }
-        if (!v_input_sources.list.count)
+        if (v_batch_name && v_deps_format == DEPS_FORMAT_NINJA)
         {
-            if (add_error ("No source files were specified."))
+            if (add_error ("Ninja dependency file format allows a single rule only (no --batch)."))
                 exit (EXIT_FAILURE);
         }
         if (errors.list.count)
@@ -794,15 +1589,76 @@ int main (int argc, char **argv)
                 exit (EXIT_FAILURE);
         }
         _DBG_dump_vars ();
-        if (make_rule ())
+        _syntax_to_str (v_syntax, &syntax);
+        if (v_server)
+            v_scan_cache = &v_server_caches[v_syntax];
+        else if (v_cache_name)
+        {
+            if (scan_cache_load (&v_cache, v_cache_name, syntax))
+                error_exit ("Failed to read cache file.");
+            v_scan_cache = &v_cache;
+        }
+        if (scan_sources ())
             error_exit ("Failed to parse sources.");
-        if (write_rule (v_output_name))
+        // In batch mode rules of all sources are collected in one file
+        stats_begin (&timer);
+        strbuf_clear (&rules);
+        for (isrc = (struct input_source_entry_t *) v_input_sources.list.first; isrc;
+             isrc = (struct input_source_entry_t *) isrc->list_entry.next)
+        {
+            prerequisites_clear (&prerequisites);
+            if (make_rule (isrc, &prerequisites))
+                error_exit ("Failed to parse sources.");
+            if (add_rule (&rules, &isrc->targets, &prerequisites))
+                error_exit ("Failed to write to output file.");
+            prerequisites_free (&prerequisites);
+            if (!v_batch_name)
+            {
+                if (write_rules (isrc->output, &rules))
+                    error_exit ("Failed to write to output file.");
+                rules.len = 0;
+            }
+        }
+        if (v_batch_name && write_rules (v_batch_name, &rules))
             error_exit ("Failed to write to output file.");
+        strbuf_free (&rules);
+        stats_end (&timer, STATS_PHASE_WRITE);
+        if (v_scan_cache == &v_cache && scan_cache_save (&v_cache, v_cache_name, syntax))
+            error_exit ("Failed to write cache file.");
+        sources_free (&v_sources);
         break;
     default:
         error_exit ("Action %u is not implemented yet.", v_act);
         break;
     }
 
+    print_stats ();
+    save_trace ();
     return EXIT_SUCCESS;
 }
+
+int main (int argc, char **argv)
+{
+    int status;
+
+    setlocale (LC_CTYPE, "C");
+
+    if (argc >= 3 && strcmp (argv[1], "--server") == 0)
+    {
+        if (argc != 3)
+            error_exit ("No other options are allowed in server mode. %s" NL, HELP_HINT);
+        v_server = true;
+        return server_main (argv[2], v_server_caches, run);
+    }
+
+    if (argc >= 3 && strcmp (argv[1], "--client") == 0)
+    {
+        status = client_main (argv[2], argc - 2, argv + 2);
+        if (status >= 0)
+            return status;
+        // Server is not available - do it ourselves
+        return run (argc - 2, argv + 2);
+    }
+
+    return run (argc, argv);
+}
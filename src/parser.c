@@ -8,7 +8,6 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include "debug.h"
 #include "l_ifile.h"
 #include "parser.h"
@@ -53,36 +52,54 @@ bool _syntax_to_str (unsigned syntax, const char **name)
     return false;
 }
 
-const char *_skip_blanks (const char *s)
+// Character classes (do not depend on locale)
+
+#define CHCL_BLANK      (1 << 0)
+#define CHCL_WORD_START (1 << 1)
+#define CHCL_WORD       (1 << 2)
+
+const unsigned char char_class[256] =
+{
+    ['\t'] = CHCL_BLANK,
+    [' '] = CHCL_BLANK,
+    ['0' ... '9'] = CHCL_WORD,
+    ['A' ... 'Z'] = CHCL_WORD_START | CHCL_WORD,
+    ['_'] = CHCL_WORD_START,
+    ['a' ... 'z'] = CHCL_WORD_START | CHCL_WORD
+};
+
+#define _is_char_class(c, cl) (char_class[(unsigned char) (c)] & (cl))
+
+const char *_skip_blanks (const char *s, const char *end)
 {
-    if (s) while (*s != '\0' && isblank(*s)) s++;
+    while (s < end && _is_char_class (*s, CHCL_BLANK)) s++;
     return s;
 }
 
-const char *_skip_word (const char *s)
+const char *_skip_word (const char *s, const char *end)
 {
-    if (s)
+    if (s < end)
     {
-        if (*s == '_' || isalpha(*s))
+        if (_is_char_class (*s, CHCL_WORD_START))
         {
             s++;
-            while (*s != '\0' && isalnum(*s)) s++;
+            while (s < end && _is_char_class (*s, CHCL_WORD)) s++;
         }
     }
     return s;
 }
 
-const char *_skip_string (const char *s)
+const char *_skip_string (const char *s, const char *end)
 {
     const char *p;
     p = s;
-    if (p)
+    if (p < end)
     {
         if (*p == '"')
         {
             p++;        // Skip opening double quote character
-            while (*p != '\0' && *p != '"') p++;
-            if (*p == '"')
+            while (p < end && *p != '"') p++;
+            if (p < end)
                 p++;    // Skip closing double quote character
             else
                 p = s;  // Fail
@@ -91,186 +108,156 @@ const char *_skip_string (const char *s)
     return p;
 }
 
-#define TEXT_BUF_SIZE 15
-char get_include_tasm (const char *s, unsigned *flags, char **name)
+// Directives
+
+struct directive_t
 {
-    char st;
-    char buf[TEXT_BUF_SIZE+1];
-    const char *endp, *np;
-    unsigned sl, nl;
-    unsigned inc_flags;
-    char *inc_name;
+    const char *name;   // in lower case
+    unsigned len;
+    unsigned flags;     // of included file
+};
 
-    st = PARST_SKIP;
-    inc_name = (char *) NULL;
+#define DIRECTIVES_MAX 4
 
-    if (!flags || !name)
-        goto _error_exit;
+// Directives of every syntax are listed once as "X (name, flags)" and make
+// both the syntax rules and the keys of lines to parse (see "include_procs").
+// Names must be of lower case letters only: case is ignored by comparing
+// characters with the case bit set ("_match_directive", "asmfile.c").
 
-    // RegEx pattern: [[:space:]]*include[[:space:]]+"[^[:space:]]+"
-    // The rest of a line is not analized.
+#define TASM_DIRECTIVES(X) \
+    X ("include", SRCFL_PARSE)
 
-    // blanks
-    endp = _skip_blanks (s);
-    if (*endp == '\0')
-        goto _skip_line;
-    // assembler directive
-    s = endp;
-    endp = _skip_word (s);
-    if (s == endp || *endp == '\0')
-        goto _skip_line;
-    // (save it)
-    sl = endp - s;
-    if (sl > TEXT_BUF_SIZE)
-        sl = TEXT_BUF_SIZE;
-    memcpy (buf, s, sl);
-    buf[sl] = '\0';
-    // (check it)
-    if (!strcasecmp (buf, "include"))
-        inc_flags = SRCFL_PARSE;
-    else
-        goto _skip_line;
-    // blanks
-    s = endp;
-    endp = _skip_blanks (s);
-    if (s == endp || *endp == '\0')
-        goto _skip_line;
-    // string
-    s = endp;
-    endp = _skip_string (s);
-    if (s == endp)
-        goto _skip_line;
-    // (save it)
-    np = s + 1;         // skip opening double quotes character
-    nl = endp - s - 2;  // excluding double quotes characters
-    inc_name = malloc (nl + 1); // including terminating zero
-    if (!inc_name)
-    {
-        // Fail
-        _perror ("malloc");
-        goto _error_exit;
-    }
-    memcpy (inc_name, np, nl);
-    inc_name[nl] = '\0';
-    // (done)
-    st = PARST_OK;
-    *flags = inc_flags;
-    *name = inc_name;
-    goto _local_exit;
+#define SJASM_DIRECTIVES(X) \
+    X ("include", SRCFL_PARSE) \
+    X ("incbin", 0)
 
-_skip_line:
-    st = PARST_SKIP;
-    goto _local_exit;
+#define DIRECTIVE(name, flags) { name, sizeof (name) - 1, flags },
+#define DIRECTIVE_KEY(name, flags) name,
 
-_error_exit:
-    st = PARST_ERR;
+const char *const tasm_keys[] = { TASM_DIRECTIVES (DIRECTIVE_KEY) NULL };
+const char *const sjasm_keys[] = { SJASM_DIRECTIVES (DIRECTIVE_KEY) NULL };
 
-_local_exit:
-    if (st != PARST_OK)
+#define KEYS_COUNT(keys) (sizeof (keys) / sizeof ((keys)[0]) - 1)
+
+_Static_assert (KEYS_COUNT (tasm_keys) <= DIRECTIVES_MAX, "too many tasm directives");
+_Static_assert (KEYS_COUNT (sjasm_keys) <= DIRECTIVES_MAX, "too many sjasm directives");
+
+// Syntax rules
+
+struct syntax_rules_t
+{
+    bool indent;        // directive must be preceded by blanks
+    unsigned count;
+    struct directive_t directives[DIRECTIVES_MAX];
+};
+
+// Every line accepted matches RegEx pattern:
+//   [[:blank:]]*<directive>[[:blank:]]+"[^"]*"
+// ("[[:blank:]]+" at start when "indent" is set). The rest of a line is not analized.
+
+const struct syntax_rules_t tasm_rules =
+{
+    false, KEYS_COUNT (tasm_keys),
     {
-        if (inc_name)
-            free (inc_name);
+        TASM_DIRECTIVES (DIRECTIVE)
     }
-    return st;
-}
-#undef TEXT_BUF_SIZE
+};
+
+const struct syntax_rules_t sjasm_rules =
+{
+    true, KEYS_COUNT (sjasm_keys),
+    {
+        SJASM_DIRECTIVES (DIRECTIVE)
+    }
+};
 
-#define TEXT_BUF_SIZE 15
-char get_include_sjasm (const char *s, unsigned *flags, char **name)
+// Returns "true" if "s" of "len" characters matches "name" of a directive ignoring case.
+static inline __attribute__ ((always_inline))
+bool _match_directive (const struct directive_t *d, const char *s, unsigned len)
 {
-    char st;
-    char buf[TEXT_BUF_SIZE+1];
-    const char *endp, *np;
-    unsigned sl, nl;
-    unsigned inc_flags;
-    char *inc_name;
+    unsigned i;
 
-    st = PARST_SKIP;
-    inc_name = (char *) NULL;
+    if (len != d->len)
+        return false;
+    // Word characters of a letter differ in case bit only
+    for (i = 0; i < len; i++)
+        if ((s[i] | 0x20) != d->name[i])
+            return false;
+    return true;
+}
 
-    if (!flags || !name)
-        goto _error_exit;
+// Matcher engine. It is inlined into every syntax parser with constant
+// "rules", so loops over directives are unrolled by compiler.
+static inline __attribute__ ((always_inline))
+char _get_include (const struct syntax_rules_t *rules,
+    const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len)
+{
+    const char *end, *endp;
+    unsigned i;
 
-    // RegEx pattern: [[:space:]]+(include|incbin)[[:space:]]+"[^[:space:]]+"
-    // The rest of a line is not analized.
+    if (!s || !flags || !name || !name_len)
+        return PARST_ERR;
 
+    end = s + len;
     // blanks
-    endp = _skip_blanks (s);
-    if (s == endp || *endp == '\0')
-        goto _skip_line;
+    endp = _skip_blanks (s, end);
+    if ((rules->indent && s == endp) || endp == end)
+        return PARST_SKIP;
     // assembler directive
     s = endp;
-    endp = _skip_word (s);
-    if (s == endp || *endp == '\0')
-        goto _skip_line;
-    // (save it)
-    sl = endp - s;
-    if (sl > TEXT_BUF_SIZE)
-        sl = TEXT_BUF_SIZE;
-    memcpy (buf, s, sl);
-    buf[sl] = '\0';
+    endp = _skip_word (s, end);
+    if (s == endp || endp == end)
+        return PARST_SKIP;
     // (check it)
-    if (!strcasecmp (buf, "incbin"))
-        inc_flags = 0;
-    else if (!strcasecmp (buf, "include"))
-        inc_flags = SRCFL_PARSE;
-    else
-        goto _skip_line;
+    for (i = 0; i < rules->count; i++)
+        if (_match_directive (&rules->directives[i], s, endp - s))
+            break;
+    if (i == rules->count)
+        return PARST_SKIP;
     // blanks
     s = endp;
-    endp = _skip_blanks (s);
-    if (s == endp || *endp == '\0')
-        goto _skip_line;
+    endp = _skip_blanks (s, end);
+    if (s == endp || endp == end)
+        return PARST_SKIP;
     // string
     s = endp;
-    endp = _skip_string (s);
+    endp = _skip_string (s, end);
     if (s == endp)
-        goto _skip_line;
-    // (save it)
-    np = s + 1;         // skip opening double quotes character
-    nl = endp - s - 2;  // excluding double quotes characters
-    inc_name = malloc (nl + 1); // including terminating zero
-    if (!inc_name)
-    {
-        // Fail
-        _perror ("malloc");
-        goto _error_exit;
-    }
-    memcpy (inc_name, np, nl);
-    inc_name[nl] = '\0';
+        return PARST_SKIP;
     // (done)
-    st = PARST_OK;
-    *flags = inc_flags;
-    *name = inc_name;
-    goto _local_exit;
-
-_skip_line:
-    st = PARST_SKIP;
-    goto _local_exit;
+    *flags = rules->directives[i].flags;
+    *name = s + 1;                      // skip opening double quotes character
+    *name_len = endp - s - 2;           // excluding double quotes characters
+    return PARST_OK;
+}
 
-_error_exit:
-    st = PARST_ERR;
+char get_include_tasm (const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len)
+{
+    return _get_include (&tasm_rules, s, len, flags, name, name_len);
+}
 
-_local_exit:
-    if (st != PARST_OK)
-    {
-        if (inc_name)
-            free (inc_name);
-    }
-    return st;
+char get_include_sjasm (const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len)
+{
+    return _get_include (&sjasm_rules, s, len, flags, name, name_len);
 }
-#undef TEXT_BUF_SIZE
+
+// "keys" are names of the directives a parser accepts (see "DIRECTIVE_KEY").
+// Lines not containing any of them as a word are skipped without parsing.
 
 const struct
 {
     get_include_proc_t *proc;
+    const char *const *keys;
     unsigned syntax;
 }
 include_procs[] =
 {
-    { get_include_tasm, SYNTAX_TASM },
-    { get_include_sjasm, SYNTAX_SJASM },
-    { NULL, 0 }
+    { get_include_tasm, tasm_keys, SYNTAX_TASM },
+    { get_include_sjasm, sjasm_keys, SYNTAX_SJASM },
+    { NULL, NULL, 0 }
 };
 
 bool _find_get_include_proc (unsigned syntax, get_include_proc_t **proc)
@@ -286,3 +273,17 @@ bool _find_get_include_proc (unsigned syntax, get_include_proc_t **proc)
     }
     return false;
 }
+
+bool _find_get_include_keys (unsigned syntax, const char *const **keys)
+{
+    unsigned i;
+    for (i = 0; include_procs[i].proc; i++)
+    {
+        if (include_procs[i].syntax == syntax)
+        {
+            *keys = include_procs[i].keys;
+            return true;
+        }
+    }
+    return false;
+}
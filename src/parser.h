@@ -15,6 +15,7 @@
 
 #define SYNTAX_TASM  0
 #define SYNTAX_SJASM 1
+#define SYNTAX_COUNT 2
 
 bool _str_to_syntax (const char *name, unsigned *syntax);
 bool _syntax_to_str (unsigned syntax, const char **name);
@@ -27,14 +28,22 @@ bool _syntax_to_str (unsigned syntax, const char **name);
 
 // Parser
 
-// Caller must free "name"
-char get_include_tasm (const char *s, unsigned *flags, char **name);
+// A line is given by "s" and "len" (it is not required to be zero-terminated).
+// On success "name" and "name_len" point to the included file name inside the line.
 
-// Caller must free "name"
-char get_include_sjasm (const char *s, unsigned *flags, char **name);
+char get_include_tasm (const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len);
 
-typedef char get_include_proc_t (const char *s, unsigned *flags, char **name);
+char get_include_sjasm (const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len);
+
+typedef char get_include_proc_t (const char *s, unsigned len, unsigned *flags,
+    const char **name, unsigned *name_len);
 
 bool _find_get_include_proc (unsigned syntax, get_include_proc_t **proc);
 
+// "keys" is set to a NULL-terminated list of lower case words (directives)
+// one of which is found in every line accepted by the parser.
+bool _find_get_include_keys (unsigned syntax, const char *const **keys);
+
 #endif  // !_PARSER_H_INCLUDED
@@ -10,11 +10,16 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <libgen.h>
+#include <dirent.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "platform.h"
+#include "probe.h"
+#include "stats.h"
 
 #include "debug.h"
 
@@ -33,169 +38,458 @@ bool check_path_abs (const char *path)
 # define ROOT_START 0
 #endif
 
-char *resolve_full_path (const char *path)
+#define _is_sep(c) ((c) == '/' || (c) == '\\')
+
+// Path is normalized in one pass: components are appended to result and
+// ".." removes the last one. Result is the same as of a former version
+// which replaced "/./" with "/" in a single left-to-right pass before
+// removing "/../" - so in a run of "." components every second one is
+// kept as a regular component ("/a/././b" gives "/a/./b").
+bool normalize_path (const char *path, char *buf, unsigned size)
 {
-    char *s;
-    unsigned len, i, j;
-    bool last_sep, f;
+    const char *s, *e;
+    unsigned len, o;
+    bool last_sep, dot_removed;
 
-    if (!path || path[0] == '\0')
+    if (!path || path[0] == '\0' || !buf)
     {
-        errno = path ? ENOENT : EINVAL;
-        return (char *) NULL;
+        errno = (path && buf) ? ENOENT : EINVAL;
+        return false;
     }
     if (!check_path_abs (path))
     {
         errno = EINVAL;
-        return (char *) NULL;
+        return false;
     }
 
     len = strlen (path);
-    s = malloc (len+3); // + terminating zero + 2 chars (=3)
-    if (!s)
-        return (char *) NULL;
-    strcpy (s, path);   // fine (sizeof (s) > sizeof (path))
+    if (size < len + 1)         // result is never longer than "path"
+    {
+        errno = ERANGE;
+        return false;
+    }
 
-    // Replace '\\' or '/' with PATHSEP. From here all '/' in comments must be treated as PATHSEP.
-    for (i = ROOT_START; s[i] != '\0'; i++)
-#if defined (_WIN32) || defined(_WIN64)
-        if (s[i] == '/')
-#else
-        if (s[i] == '\\')
-#endif
-            s[i] = PATHSEP;
+    stats_add (STAT_NORMALIZATIONS, 1);
 
-    last_sep = s[len-1] == PATHSEP;     // remember if last char is PATHSEP to keep it
+    last_sep = _is_sep (path[len - 1]); // keep trailing separator if it was
 
-    // Replace multiple '/' with single '/'
-    i = ROOT_START;
-    j = ROOT_START;
-    while (s[j] != '\0')
-    {
-        if (s[j] == PATHSEP)
-            while (s[j+1] == PATHSEP)
-                j++;    // skip one char
-        s[i] = s[j];
-        i++;
-        j++;
-    }
-    s[i] = '\0';
-    len = i;
+    // Root
+    memcpy (buf, path, ROOT_START);
+    buf[ROOT_START] = PATHSEP;
+    o = ROOT_START + 1;
 
-    // Replace '/.' with '/./', and '/..' with '/../' at end
-    if (len >= (ROOT_START+2) && s[len-1] == '.')
+    dot_removed = false;
+    s = path + ROOT_START;
+    for (;;)
     {
-        if ((len >= (ROOT_START+3) && s[len-3] == PATHSEP && s[len-2] == '.')
-        ||  (s[len-2] == PATHSEP))
+        while (_is_sep (*s))
+            s++;
+        if (*s == '\0')
+            break;
+        e = s;
+        while (*e != '\0' && !_is_sep (*e))
+            e++;
+
+        if (e - s == 1 && s[0] == '.' && !dot_removed)
         {
-            s[len] = PATHSEP;
-            len++;
-            s[len] = '\0';
+            // "."
+            dot_removed = true;
         }
-    }
-
-    // Replace "/./" with '/'
-    i = ROOT_START;
-    j = ROOT_START;
-    while (s[j] != '\0')
-    {
-        if (s[j] == PATHSEP && s[j+1] == '.' && s[j+2] == PATHSEP)
-            j += 2;     // skip two chars
-        s[i] = s[j];
-        i++;
-        j++;
-    }
-    s[i] = '\0';
-    len = i;
-
-    // Remove all "/../"
-    do
-    {
-        f = false;
-        i = ROOT_START;
-        while (s[i] != '\0'
-        &&     (!(s[i] == PATHSEP && s[i+1] == '.' && s[i+2] == '.' && s[i+3] == PATHSEP)))
-            i++;
-        if (s[i] != '\0')
+        else if (e - s == 2 && s[0] == '.' && s[1] == '.')
         {
-            // check bad path at start: "/../", "A:/../"
-            if (i == ROOT_START)
+            // ".." - remove last component
+            if (o == ROOT_START + 1)
             {
-                free (s);
                 errno = EINVAL;
-                return (char *) NULL;
-            }
-            j = i - 1;
-            while (j > ROOT_START && s[j] != PATHSEP)
-                j--;
-            // remove part of string [j, i+2]
-            i += 3;
-            while (s[i] != '\0')
-            {
-                s[j] = s[i];
-                i++;
-                j++;
+                return false;
             }
-            s[j] = '\0';
-            f = true;
+            while (o > ROOT_START + 1 && buf[o - 1] != PATHSEP)
+                o--;
+            if (o > ROOT_START + 1)
+                o--;    // separator
+            dot_removed = false;
         }
-    } while (f);
+        else
+        {
+            // regular component
+            if (o > ROOT_START + 1)
+                buf[o++] = PATHSEP;
+            memcpy (buf + o, s, e - s);
+            o += e - s;
+            dot_removed = false;
+        }
+        s = e;
+    }
 
-    // Restore '/' at end if it was and remove it if there wasn't
-    len = strlen (s);
-    if (last_sep && len > ROOT_START && s[len-1] != PATHSEP)
+    if (last_sep && o > ROOT_START + 1)
+        buf[o++] = PATHSEP;
+    buf[o] = '\0';
+    return true;
+}
+
+char *resolve_full_path (const char *path)
+{
+    char *s;
+    unsigned size;
+
+    if (!path)
     {
-        s[len] = PATHSEP;
-        len++;
-        s[len] = '\0';
+        errno = EINVAL;
+        return (char *) NULL;
     }
-    else if (!last_sep && len > ROOT_START && len != ROOT_START+1 && s[len-1] == PATHSEP)
+
+    size = strlen (path) + 1;   // + terminating zero
+    s = malloc (size);
+    if (!s)
+        return (char *) NULL;
+
+    if (!normalize_path (path, s, size))
     {
-        len--;
-        s[len] = '\0';
+        free (s);
+        return (char *) NULL;
     }
 
-    return realloc (s, len+1);  // + terminating zero (strlen (s) <= strlen (path))
+    return s;
 }
 
-bool check_path_exists (const char *path)
+// Returns "true" on success. Check "errno" on fail.
+// Probes normalized "path" with "proc". Small paths are normalized on stack.
+bool _probe_normalized (const char *path, bool (*proc) (const char *real))
 {
+    char buf[PATH_MAX];
     char *s;
-    struct stat st;
     bool ok;
 
+    if (path && strlen (path) < sizeof (buf))
+        return normalize_path (path, buf, sizeof (buf)) && proc (buf);
+
     s = resolve_full_path (path);
     if (!s)
         return false;
 
-    ok = stat (s, &st) >= 0;
+    ok = proc (s);
 
     free (s);
 
-    if (!ok)
-        return false;
+    return ok;
+}
 
-    return (S_ISDIR (st.st_mode)) != 0;
+bool check_path_exists (const char *path)
+{
+    return _probe_normalized (path, probe_is_dir);
 }
 
 bool check_file_exists (const char *path)
 {
+    return _probe_normalized (path, probe_is_file);
+}
+
+bool check_path_plain (const char *path)
+{
+    const char *s, *e;
+
+    if (!path || check_path_abs (path))
+        return false;
+
+    for (s = path;; s = e + 1)
+    {
+        e = s;
+        while (*e != '\0' && *e != '/')
+        {
+            if (*e == '\\')
+                return false;
+            e++;
+        }
+        if (e == s
+        ||  (e - s == 1 && s[0] == '.')
+        ||  (e - s == 2 && s[0] == '.' && s[1] == '.'))
+            return false;
+        if (*e == '\0')
+            return true;
+    }
+}
+
+bool check_file_exists_at (const char *dir, int dir_fd, const char *name)
+{
+    char buf[PATH_MAX];
     char *s;
-    struct stat st;
+    unsigned len;
+    int n;
     bool ok;
 
-    s = resolve_full_path (path);
+    if (!dir || !name)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    len = strlen (dir);
+    if (dir_fd >= 0 && check_path_plain (name))
+    {
+        // Result of "normalize_path" is known
+        n = snprintf (buf, sizeof (buf), "%s%s%s", dir,
+            (len && _is_sep (dir[len - 1])) ? "" : PATHSEPSTR, name);
+        if (n >= 0 && (unsigned) n < sizeof (buf))
+            return probe_is_file_at (buf, dir_fd, name);
+    }
+
+    s = malloc (len + 1 + strlen (name) + 1);
     if (!s)
         return false;
+    sprintf (s, "%s" PATHSEPSTR "%s", dir, name);
 
-    ok = stat (s, &st) >= 0;
+    ok = check_file_exists (s);
 
     free (s);
 
-    if (!ok)
+    return ok;
+}
+
+bool get_file_info (const char *path, unsigned long long *size, long long *mtime)
+{
+    struct stat st;
+
+    stats_add (STAT_STAT_CALLS, 1);
+    if (stat (path, &st) < 0)
+        return false;
+
+    *size = st.st_size;
+#if defined (_WIN32) || defined(_WIN64)
+    *mtime = (long long) st.st_mtime * 1000000000LL;
+#else
+    *mtime = (long long) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool get_current_time (long long *now)
+{
+#if defined (_WIN32) || defined(_WIN64)
+    time_t t;
+
+    t = time (NULL);
+    if (t == (time_t) -1)
+        return false;
+    *now = (long long) t * 1000000000LL;
+#else
+    struct timespec ts;
+
+    if (clock_gettime (CLOCK_REALTIME, &ts) < 0)
         return false;
+    *now = (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+    return true;
+}
+
+// Returns "true" if text file "name" has exactly "data" of "len" characters.
+bool _file_equals (const char *name, const char *data, size_t len)
+{
+    FILE *f;
+    char buf[4096];
+    size_t n;
+    bool equal;
+
+    f = fopen (name, "r");
+    if (!f)
+        return false;
+
+    equal = true;
+    while (equal && (n = fread (buf, 1, sizeof (buf), f)) > 0)
+    {
+        if (n > len || memcmp (buf, data, n))
+            equal = false;
+        else
+        {
+            data += n;
+            len -= n;
+        }
+    }
+    if (ferror (f) || len)
+        equal = false;
+
+    fclose (f);
+    return equal;
+}
+
+bool write_file_if_changed (const char *name, const char *data, size_t len, bool *changed)
+{
+    bool ok;
+    FILE *f;
+    char *tmp;
+    size_t size;
+
+    if (changed)
+        *changed = false;
+
+    if (!name || (!data && len))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    if (_file_equals (name, data, len))
+        return true;    // Success (nothing to do)
+
+    ok = false;
+    f = (FILE *) NULL;
+
+    // Never leave a partially written file under "name"
+    size = strlen (name) + 1 + 20 + 1;
+    tmp = malloc (size);
+    if (!tmp)
+        goto _local_exit;
+    snprintf (tmp, size, "%s.%u", name, (unsigned) getpid ());
+
+    f = fopen (tmp, "w");
+    if (!f)
+        goto _local_exit;
+
+    if (len && fwrite (data, 1, len, f) != len)
+        goto _local_exit;
+
+    if (fclose (f))
+    {
+        f = (FILE *) NULL;
+        goto _local_exit;
+    }
+    f = (FILE *) NULL;
+
+#if defined (_WIN32) || defined(_WIN64)
+    remove (name);
+#endif
+    if (rename (tmp, name))
+        goto _local_exit;
+
+    if (changed)
+        *changed = true;
+    ok = true;
+
+_local_exit:
+    if (f)
+        fclose (f);
+    if (tmp)
+    {
+        if (!ok)
+            remove (tmp);
+        free (tmp);
+    }
+    return ok;
+}
+
+int _walk_dir_cmp (const void *a, const void *b)
+{
+    return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+bool walk_dir (const char *path, const char *suffix, walk_dir_proc_t *proc, void *arg)
+{
+    bool ok;
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    char **names, **p, *name;
+    unsigned count, size, i, len, sl;
+
+    if (!path || !suffix || !proc)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    if (stat (path, &st) < 0)
+        return false;
+    if (!S_ISDIR (st.st_mode))
+    {
+        errno = ENOTDIR;
+        return false;
+    }
+
+    ok = false;
+    names = (char **) NULL;
+    count = 0;
+    size = 0;
+    name = (char *) NULL;
+
+    // Names are sorted to get the same order on every system
+    d = opendir (path);
+    if (!d)
+        return false;
+    while ((de = readdir (d)) != NULL)
+    {
+        if (de->d_name[0] == '.')
+            continue;   // ".", ".." and hidden ones
+        if (count == size)
+        {
+            size = size ? size * 2 : 64;
+            p = realloc (names, size * sizeof (char *));
+            if (!p)
+            {
+                closedir (d);
+                goto _local_exit;
+            }
+            names = p;
+        }
+        names[count] = strdup (de->d_name);
+        if (!names[count])
+        {
+            closedir (d);
+            goto _local_exit;
+        }
+        count++;
+    }
+    closedir (d);
+
+    if (count)
+        qsort (names, count, sizeof (char *), _walk_dir_cmp);
+
+    len = strlen (path);
+    sl = strlen (suffix);
+    for (i = 0; i < count; i++)
+    {
+        name = malloc (len + 1 + strlen (names[i]) + 1);
+        if (!name)
+            goto _local_exit;
+        if (!strcmp (path, "."))
+            strcpy (name, names[i]);    // no need for "./" prefix
+        else
+            sprintf (name, "%s%s%s", path, _is_sep (path[len - 1]) ? "" : PATHSEPSTR, names[i]);
+
+        // Symbolic links to directories are not followed: they may make loops
+#if !defined (_WIN32) && !defined(_WIN64)
+        if (lstat (name, &st) == 0 && S_ISLNK (st.st_mode)
+        &&  (stat (name, &st) < 0 || S_ISDIR (st.st_mode)))
+            _DBG_ ("Skipped symbolic link '%s'.", name);
+        else
+#endif
+        if (stat (name, &st) == 0)
+        {
+            if (S_ISDIR (st.st_mode))
+            {
+                if (!walk_dir (name, suffix, proc, arg))
+                    goto _local_exit;
+            }
+            else if (strlen (names[i]) >= sl
+                 &&  !strcmp (names[i] + strlen (names[i]) - sl, suffix))
+            {
+                if (proc (name, arg))
+                    goto _local_exit;
+            }
+        }
+
+        free (name);
+        name = (char *) NULL;
+    }
+
+    ok = true;
 
-    return (S_ISREG (st.st_mode)) || ((st.st_mode & S_IFMT) == 0);
+_local_exit:
+    if (name)
+        free (name);
+    for (i = 0; i < count; i++)
+        free (names[i]);
+    if (names)
+        free (names);
+    return ok;
 }
 
 char *get_current_dir (void)
@@ -9,6 +9,7 @@
 #include "defs.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #if defined (_WIN32) || defined(_WIN64)
 # define PATHSEP '\\'
@@ -21,16 +22,56 @@
 // Returns "true" on success.
 bool check_path_abs (const char *path);
 
+// Returns "true" on success. Check "errno" on fail.
+// Writes normalized absolute "path" (zero-terminated) to "buf" of "size"
+// bytes ("strlen (path) + 1" bytes are always enough).
+bool normalize_path (const char *path, char *buf, unsigned size);
+
 // Returns string on success and "NULL" on fail. Check "errno" on fail.
 // Result must be freed by caller.
 char *resolve_full_path (const char *path);
 
 // Returns "true" on success. Check "errno" on fail.
+// Result is cached for the run (see "probe_path").
 bool check_path_exists (const char *path);
 
 // Returns "true" on success. Check "errno" on fail.
+// Result is cached for the run (see "probe_path").
 bool check_file_exists (const char *path);
 
+// Returns "true" if relative "path" may be appended to a normalized path as
+// is: it has no "." or ".." components, no empty ones and only "/" separators.
+bool check_path_plain (const char *path);
+
+// Returns "true" on success. Check "errno" on fail.
+// Checks file "name" in directory "dir" (full normalized path) relative to
+// its descriptor "dir_fd" (see "probe_dir_fd") or -1 if there is none.
+bool check_file_exists_at (const char *dir, int dir_fd, const char *name);
+
+// Returns "true" on success. Check "errno" on fail.
+// "mtime" is a modification time in nanoseconds (if supported by system).
+bool get_file_info (const char *path, unsigned long long *size, long long *mtime);
+
+// Returns "true" on success. Check "errno" on fail.
+// "now" is the current time in units of "mtime" of "get_file_info".
+bool get_current_time (long long *now);
+
+// Returns "true" on success. Check "errno" on fail.
+// Text file "name" is replaced with "data" of "len" characters at once (by a
+// temporary file) and only if its contents differ ("changed" is set then).
+bool write_file_if_changed (const char *name, const char *data, size_t len, bool *changed);
+
+// Returns "false" on success.
+typedef bool walk_dir_proc_t (const char *path, void *arg);
+
+// Returns "true" on success. Check "errno" on fail ("ENOTDIR" if "path" is
+// not a directory).
+// Calls "proc" for every file with a name ending with "suffix" in directory
+// "path" and its subdirectories (hidden ones and symbolic links to directories
+// are skipped) in sorted order.
+// Found names start with "path" (except for ".").
+bool walk_dir (const char *path, const char *suffix, walk_dir_proc_t *proc, void *arg);
+
 // Returns string on success and "NULL" on fail. Check "errno" on fail.
 // Result must be freed by caller.
 char *get_current_dir (void);
@@ -0,0 +1,223 @@
+/* probe.c - file system probes cache.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <fcntl.h>
+# include <pthread.h>
+#endif
+#include "debug.h"
+#include "arena.h"
+#include "intern.h"
+#include "l_hash.h"
+#include "platform.h"
+#include "stats.h"
+#include "probe.h"
+
+struct probe_entry_t
+{
+    struct hash_entry_t hash_entry;     // indexed by "probe.real"
+    struct probe_t probe;
+    int fd;     // opened directory, -1 if not opened yet, -2 if failed
+};
+
+struct arena_t _probe_arena;
+struct hash_t _probe_hash;
+unsigned _probe_dir_fds;        // number of opened directories
+
+// Paths are probed by worker threads too (system is called unlocked)
+#if !defined (_WIN32) && !defined(_WIN64)
+pthread_mutex_t _probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+# define _probe_lock() pthread_mutex_lock (&_probe_mutex)
+# define _probe_unlock() pthread_mutex_unlock (&_probe_mutex)
+#else   // defined (_WIN32) || defined(_WIN64)
+# define _probe_lock()
+# define _probe_unlock()
+#endif  // defined (_WIN32) || defined(_WIN64)
+
+void _probe_stat (struct probe_t *self, int dir_fd, const char *name)
+{
+    struct stat st;
+    int status;
+
+    stats_add (STAT_STAT_CALLS, 1);
+#if !defined (_WIN32) && !defined(_WIN64)
+    if (dir_fd >= 0 && check_path_plain (name))
+        status = fstatat (dir_fd, name, &st, 0);
+    else
+#endif
+        status = stat (self->real, &st);
+
+    if (status < 0)
+    {
+        self->type = PROBE_MISSING;
+        self->size = 0;
+        self->mtime = 0;
+        return;
+    }
+
+    if (S_ISREG (st.st_mode) || (st.st_mode & S_IFMT) == 0)
+        self->type = PROBE_FILE;
+    else if (S_ISDIR (st.st_mode))
+        self->type = PROBE_DIR;
+    else
+        self->type = PROBE_OTHER;
+    self->size = st.st_size;
+#if defined (_WIN32) || defined(_WIN64)
+    self->mtime = (long long) st.st_mtime * 1000000000LL;
+#else
+    self->mtime = (long long) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+// Must be called locked.
+struct probe_entry_t *_probe_find (const char *real)
+{
+    struct hash_entry_t *h;
+    struct probe_entry_t *p;
+
+    for (h = hash_first (&_probe_hash, intern_hash (real)); h; h = hash_next (h))
+    {
+        p = hash_entry_owner (h, struct probe_entry_t, hash_entry);
+        if (p->probe.real == real)
+            return p;
+    }
+    return NULL;
+}
+
+struct probe_entry_t *_probe_get (const char *real, int dir_fd, const char *name)
+{
+    struct probe_entry_t *p;
+    struct probe_t probe;
+
+    if (!real)
+    {
+        _DBG ("Bad arguments.");
+        return NULL;
+    }
+
+    real = intern_str (real);
+    if (!real)
+    {
+        _perror ("intern_str");
+        return NULL;
+    }
+
+    _probe_lock ();
+    p = _probe_find (real);
+    _probe_unlock ();
+    if (p)
+    {
+        stats_add (STAT_PROBE_HITS, 1);
+        return p;       // Success (cached)
+    }
+
+    probe.real = real;
+    _probe_stat (&probe, dir_fd, name);
+
+    _probe_lock ();
+    p = _probe_find (real);     // may be added by another thread meanwhile
+    if (!p)
+    {
+        p = arena_alloc (&_probe_arena, sizeof (struct probe_entry_t));
+        if (!p)
+            _perror ("arena_alloc");
+        else
+        {
+            hash_entry_clear (&p->hash_entry);
+            p->probe = probe;
+            p->fd = -1;
+            if (hash_add_entry (&_probe_hash, &p->hash_entry, intern_hash (real)))
+            {
+                _perror ("hash_add_entry");
+                p = NULL;       // left in arena
+            }
+            else
+                _DBG_ ("Probed '%s' (type %u).", real, p->probe.type);
+        }
+    }
+    _probe_unlock ();
+
+    return p;
+}
+
+const struct probe_t *probe_path (const char *real)
+{
+    struct probe_entry_t *p;
+
+    p = _probe_get (real, -1, NULL);
+    return p ? &p->probe : NULL;
+}
+
+const struct probe_t *probe_path_at (const char *real, int dir_fd, const char *name)
+{
+    struct probe_entry_t *p;
+
+    p = _probe_get (real, dir_fd, name);
+    return p ? &p->probe : NULL;
+}
+
+int probe_dir_fd (const char *real)
+{
+#if !defined (_WIN32) && !defined(_WIN64)
+    struct probe_entry_t *p;
+    int fd;
+
+    p = _probe_get (real, -1, NULL);
+    if (!p || p->probe.type != PROBE_DIR)
+        return -1;
+
+    _probe_lock ();
+    if (p->fd == -1)
+    {
+        p->fd = -2;
+        if (_probe_dir_fds < PROBE_DIR_FDS_MAX)
+        {
+            p->fd = open (p->probe.real, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (p->fd >= 0)
+                _probe_dir_fds++;
+            else
+            {
+                _perror ("open");
+                p->fd = -2;
+            }
+        }
+    }
+
+    fd = p->fd >= 0 ? p->fd : -1;
+    _probe_unlock ();
+    return fd;
+#else   // defined (_WIN32) || defined(_WIN64)
+    return -1;
+#endif  // defined (_WIN32) || defined(_WIN64)
+}
+
+bool probe_is_file (const char *real)
+{
+    const struct probe_t *p;
+
+    p = probe_path (real);
+    return p && p->type == PROBE_FILE;
+}
+
+bool probe_is_file_at (const char *real, int dir_fd, const char *name)
+{
+    const struct probe_t *p;
+
+    p = probe_path_at (real, dir_fd, name);
+    return p && p->type == PROBE_FILE;
+}
+
+bool probe_is_dir (const char *real)
+{
+    const struct probe_t *p;
+
+    p = probe_path (real);
+    return p && p->type == PROBE_DIR;
+}
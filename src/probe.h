@@ -0,0 +1,58 @@
+/* probe.h - declarations for "probe.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _PROBE_H_INCLUDED
+#define _PROBE_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+
+// File system probes cache
+// Every path is checked by system only once per run, missing paths too.
+// Thread-safe: included files are resolved by worker threads. Two threads
+// may probe a new path at once, the first result is kept.
+
+#define PROBE_MISSING 0
+#define PROBE_FILE    1         // regular file (or of unknown type)
+#define PROBE_DIR     2
+#define PROBE_OTHER   3
+
+struct probe_t
+{
+    const char *real;   // interned
+    unsigned type;
+    unsigned long long size;
+    long long mtime;    // in nanoseconds (if supported by system)
+};
+
+// Returns probe on success and "NULL" on fail.
+// "real" must be a full normalized path (see "resolve_full_path").
+const struct probe_t *probe_path (const char *real);
+
+// Same as "probe_path" but a new "real" is checked by "name" relative to an
+// opened directory "dir_fd" (see "probe_dir_fd") without walking the whole
+// path. "real" must be a normalized path of "name" inside the directory.
+// Falls back to "real" if "dir_fd" is -1 or "name" is not a plain one (see
+// "check_path_plain").
+const struct probe_t *probe_path_at (const char *real, int dir_fd, const char *name);
+
+// Returns directory descriptor on success and -1 on fail.
+// Directory "real" (see "probe_path") is opened once and is kept open until
+// the end of run (no more than PROBE_DIR_FDS_MAX directories at once).
+int probe_dir_fd (const char *real);
+
+#define PROBE_DIR_FDS_MAX 256
+
+// Returns "true" if "real" (see "probe_path") is an existing file.
+bool probe_is_file (const char *real);
+
+// Returns "true" if "real" (see "probe_path_at") is an existing file.
+bool probe_is_file_at (const char *real, int dir_fd, const char *name);
+
+// Returns "true" if "real" (see "probe_path") is an existing directory.
+bool probe_is_dir (const char *real);
+
+#endif  // !_PROBE_H_INCLUDED
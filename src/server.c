@@ -0,0 +1,928 @@
+/* server.c - dependency server and its client.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "debug.h"
+#include "l_cache.h"
+#include "parser.h"
+#include "platform.h"
+#include "server.h"
+
+#if !defined (_WIN32) && !defined(_WIN64)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#if defined (__linux__)
+# include <sys/inotify.h>
+#endif
+
+// Protocol:
+//   client -> server: 32-bit body length with client's stdout and stderr
+//                     passed as SCM_RIGHTS, then the body: current directory
+//                     and command line arguments, each zero-terminated;
+//   server -> client: exit status (one byte) when the request is done.
+
+#define SERVER_BACKLOG 16
+#define SERVER_CLIENTS_MAX 64   // requests read or processed at once
+#define SERVER_TIMEOUT 10       // seconds to read a request
+#define SERVER_ARG_MAX 131072   // minimal size of arguments (if the system does not tell)
+
+// Client connection. Its request is read as data arrives (so a slow client
+// does not block others) and then is processed by a child process.
+struct server_client_t
+{
+    int sock;           // answered when the child exits
+    int fds[2];         // client's stdout and stderr (-1 until received)
+    uint32_t len;       // of request body (0 until received)
+    uint32_t got;       // bytes of body received
+    char *body;
+    long long deadline; // to read the request (see "_server_now")
+    pid_t pid;          // child process (0 while the request is read)
+    int fd;             // reading end of a pipe with cache updates
+};
+
+static volatile sig_atomic_t _server_stop = 0;
+static int _server_sock = -1;
+static int _server_inotify = -1;
+static struct server_client_t _server_clients[SERVER_CLIENTS_MAX];
+static unsigned _server_clients_count = 0;
+
+// Watched directories indexed by watch descriptor (NULL if it is not a directory).
+// Entries of ancestor directories are watched because a watch of a file follows
+// its inode: a replaced directory symlink or a renamed directory is not seen by it.
+static char **_server_dirs = NULL;
+static unsigned _server_dirs_count = 0;
+
+// Returns "true" on success.
+bool _write_all (int fd, const void *buf, size_t len)
+{
+    const char *p;
+    ssize_t n;
+
+    p = buf;
+    while (len)
+    {
+        n = write (fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Returns "true" on success.
+bool _read_all (int fd, void *buf, size_t len)
+{
+    char *p;
+    ssize_t n;
+
+    p = buf;
+    while (len)
+    {
+        n = read (fd, p, len);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Returns "true" on success.
+// Descriptor is not inherited by executed programs (and is made non-blocking).
+bool _set_cloexec (int fd, bool nonblock)
+{
+    int flags;
+
+    if (fcntl (fd, F_SETFD, FD_CLOEXEC) < 0)
+        return false;
+    if (nonblock)
+    {
+        flags = fcntl (fd, F_GETFL);
+        if (flags < 0 || fcntl (fd, F_SETFL, flags | O_NONBLOCK) < 0)
+            return false;
+    }
+    return true;
+}
+
+// Returns "true" on success.
+bool _make_address (const char *name, struct sockaddr_un *addr)
+{
+    if (strlen (name) >= sizeof (addr->sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memset (addr, 0, sizeof (struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    strcpy (addr->sun_path, name);
+    return true;
+}
+
+int client_main (const char *name, int argc, char **argv)
+{
+    int status;
+    int sock;
+    struct sockaddr_un addr;
+    char *cwd, *body, *p;
+    uint32_t len;
+    int i, fds[2];
+    unsigned char st;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE (sizeof (fds))];
+    } control;
+
+    status = -1;
+    sock = -1;
+    cwd = (char *) NULL;
+    body = (char *) NULL;
+
+    if (!_make_address (name, &addr))
+        goto _local_exit;       // Fail
+
+    sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        _perror ("socket");
+        goto _local_exit;
+    }
+    if (connect (sock, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    {
+        _DBG_ ("Server '%s' is not available.", name);
+        goto _local_exit;
+    }
+
+    // From here the request is either done by server or failed
+    status = EXIT_FAILURE;
+
+    cwd = get_current_dir ();
+    if (!cwd)
+    {
+        _perror ("get_current_dir");
+        goto _local_exit;
+    }
+
+    len = strlen (cwd) + 1;
+    for (i = 1; i < argc; i++)
+        len += strlen (argv[i]) + 1;
+    body = malloc (len);
+    if (!body)
+    {
+        _perror ("malloc");
+        goto _local_exit;
+    }
+    p = stpcpy (body, cwd) + 1;
+    for (i = 1; i < argc; i++)
+        p = stpcpy (p, argv[i]) + 1;
+
+    fds[0] = STDOUT_FILENO;
+    fds[1] = STDERR_FILENO;
+    memset (&msg, 0, sizeof (msg));
+    memset (&control, 0, sizeof (control));
+    iov.iov_base = &len;
+    iov.iov_len = sizeof (len);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof (control.buf);
+    cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (fds));
+    memcpy (CMSG_DATA (cmsg), fds, sizeof (fds));
+
+    fflush (stdout);
+    fflush (stderr);
+
+    if (sendmsg (sock, &msg, 0) != sizeof (len))
+    {
+        _perror ("sendmsg");
+        goto _local_exit;
+    }
+    if (!_write_all (sock, body, len))
+    {
+        _perror ("write");
+        goto _local_exit;
+    }
+    if (!_read_all (sock, &st, 1))
+    {
+        _perror ("read");
+        goto _local_exit;
+    }
+
+    status = st;
+
+_local_exit:
+    if (sock >= 0)
+        close (sock);
+    if (cwd)
+        free (cwd);
+    if (body)
+        free (body);
+    return status;
+}
+
+void _server_signal (int sig)
+{
+    _server_stop = 1;
+}
+
+#if defined (__linux__)
+
+// Returns "true" on success.
+bool _server_watch_dir (const char *dir)
+{
+    int wd;
+    char **p;
+    unsigned n;
+
+    wd = inotify_add_watch (_server_inotify, dir,
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        _perror ("inotify_add_watch");
+        return false;
+    }
+
+    if ((unsigned) wd >= _server_dirs_count)
+    {
+        n = _server_dirs_count ? _server_dirs_count : 64;
+        while (n <= (unsigned) wd)
+            n *= 2;
+        p = realloc (_server_dirs, n * sizeof (char *));
+        if (!p)
+        {
+            _perror ("realloc");
+            return false;
+        }
+        memset (p + _server_dirs_count, 0, (n - _server_dirs_count) * sizeof (char *));
+        _server_dirs = p;
+        _server_dirs_count = n;
+    }
+    if (!_server_dirs[wd])
+    {
+        _server_dirs[wd] = strdup (dir);
+        if (!_server_dirs[wd])
+        {
+            _perror ("strdup");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns "true" on success.
+// Watches every ancestor directory of "real" up to the root.
+bool _server_watch_parents (const char *real)
+{
+    char buf[PATH_MAX];
+    char *s;
+    size_t len;
+
+    len = strlen (real);
+    if (len >= sizeof (buf))
+        return false;
+    memcpy (buf, real, len + 1);
+
+    while ((s = strrchr (buf, '/')) != NULL)
+    {
+        if (s == buf)
+            return _server_watch_dir ("/");
+        *s = '\0';
+        if (!_server_watch_dir (buf))
+            return false;
+    }
+    return true;
+}
+
+// Forgets cached files with a path starting with "dir/name" ("name" is NULL for all files).
+void _server_forget (struct scan_cache_t *caches, const char *dir, const char *name)
+{
+    struct scan_cache_entry_t *p;
+    char prefix[PATH_MAX];
+    int len;
+    unsigned i;
+
+    len = 0;
+    if (name)
+    {
+        len = snprintf (prefix, sizeof (prefix), "%s/%s", strcmp (dir, "/") ? dir : "", name);
+        if (len < 0 || (unsigned) len >= sizeof (prefix))
+            name = (const char *) NULL;         // forget everything then
+    }
+
+    for (i = 0; i < SYNTAX_COUNT; i++)
+    {
+        for (p = (struct scan_cache_entry_t *) caches[i].list.first; p;
+             p = (struct scan_cache_entry_t *) p->list_entry.next)
+        {
+            if (p->watch != SCAN_CACHE_STALE
+            &&  (!name || (!strncmp (p->real, prefix, len) && (p->real[len] == '\0' || p->real[len] == '/'))))
+            {
+                _DBG_ ("Path of file '%s' was changed.", p->real);
+                p->watch = SCAN_CACHE_STALE;
+            }
+        }
+    }
+}
+
+#endif  // __linux__
+
+// Starts watching a file which was just scanned by a child process.
+void _server_watch (struct scan_cache_entry_t *p)
+{
+#if defined (__linux__)
+    int wd;
+    unsigned long long size;
+    long long mtime;
+
+    if (_server_inotify < 0)
+        return;
+
+    if (!_server_watch_parents (p->real))
+        return;
+
+    wd = inotify_add_watch (_server_inotify, p->real,
+        IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF);
+    if (wd < 0)
+    {
+        _perror ("inotify_add_watch");
+        return;
+    }
+
+    // The file (or its path) may have been changed after it was scanned
+    if (get_file_info (p->real, &size, &mtime)
+    &&  p->size == size && p->mtime == mtime)
+        p->watch = wd;
+#endif  // __linux__
+}
+
+// Forgets cached files which were changed.
+void _server_process_events (struct scan_cache_t *caches)
+{
+#if defined (__linux__)
+    char buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    const struct inotify_event *ev;
+    struct scan_cache_entry_t *p;
+    ssize_t n;
+    char *ptr;
+    unsigned i;
+
+    if (_server_inotify < 0)
+        return;
+
+    while ((n = read (_server_inotify, buf, sizeof (buf))) > 0)
+    {
+        for (ptr = buf; ptr < buf + n; ptr += sizeof (struct inotify_event) + ev->len)
+        {
+            ev = (const struct inotify_event *) ptr;
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost
+                _server_forget (caches, "/", NULL);
+                continue;
+            }
+            if (ev->wd >= 0 && (unsigned) ev->wd < _server_dirs_count && _server_dirs[ev->wd])
+            {
+                // Directory entry was changed (it is watched until removed)
+                if (ev->mask & IN_IGNORED)
+                {
+                    free (_server_dirs[ev->wd]);
+                    _server_dirs[ev->wd] = (char *) NULL;
+                }
+                else if (ev->len)
+                    _server_forget (caches, _server_dirs[ev->wd], ev->name);
+                continue;
+            }
+            // Changes are rare compared to lookups so a linear search is fine here
+            for (i = 0; i < SYNTAX_COUNT; i++)
+            {
+                for (p = (struct scan_cache_entry_t *) caches[i].list.first; p;
+                     p = (struct scan_cache_entry_t *) p->list_entry.next)
+                {
+                    if (p->watch == ev->wd)
+                    {
+                        _DBG_ ("File '%s' was changed.", p->real);
+                        p->watch = -1;
+                    }
+                }
+            }
+            if (!(ev->mask & IN_IGNORED))
+                inotify_rm_watch (_server_inotify, ev->wd);
+        }
+    }
+#endif  // __linux__
+}
+
+// Reads cache records sent by a child process.
+void _server_read_updates (int fd, struct scan_cache_t *caches)
+{
+    FILE *f;
+    char *line;
+    size_t size;
+    ssize_t n;
+    struct scan_cache_t *cache;
+    struct scan_cache_entry_t *last, *p;
+    const char *syntax;
+    unsigned i;
+
+    f = fdopen (fd, "r");
+    if (!f)
+    {
+        _perror ("fdopen");
+        close (fd);
+        return;
+    }
+
+    line = (char *) NULL;
+    size = 0;
+    cache = (struct scan_cache_t *) NULL;
+    last = (struct scan_cache_entry_t *) NULL;
+    while ((n = getline (&line, &size, f)) > 0)
+    {
+        if (line[n - 1] == '\n')
+            line[n - 1] = '\0';
+        for (i = 0; i < SYNTAX_COUNT; i++)
+        {
+            if (_syntax_to_str (i, &syntax) && scan_cache_is_header (line, syntax))
+                break;
+        }
+        if (i < SYNTAX_COUNT)
+        {
+            cache = &caches[i];
+            last = (struct scan_cache_entry_t *) NULL;
+            continue;
+        }
+        if (!cache)
+            break;      // Fail
+        p = last;
+        if (scan_cache_read_record (cache, line, &last))
+            break;      // Fail
+        if (last != p)
+            _server_watch (last);
+    }
+
+    if (line)
+        free (line);
+    fclose (f);
+}
+
+// Returns monotonic time in milliseconds.
+long long _server_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Answers a client with "status" (unless it is negative) and closes its descriptors.
+void _server_client_close (struct server_client_t *c, int status)
+{
+    unsigned char st;
+
+    if (status >= 0)
+    {
+        st = status;
+        _write_all (c->sock, &st, 1);
+    }
+    close (c->sock);
+    if (c->fds[0] >= 0)
+        close (c->fds[0]);
+    if (c->fds[1] >= 0)
+        close (c->fds[1]);
+    if (c->fd >= 0)
+        close (c->fd);
+    if (c->body)
+        free (c->body);
+}
+
+// Closes every descriptor of the server in a child process, so the child
+// keeps open neither the server's socket nor clients of other requests.
+void _server_close_all (void)
+{
+    struct server_client_t *c;
+    unsigned n;
+
+    close (_server_sock);
+    if (_server_inotify >= 0)
+        close (_server_inotify);
+    for (n = 0; n < _server_clients_count; n++)
+    {
+        c = &_server_clients[n];
+        close (c->sock);
+        if (c->fds[0] >= 0)
+            close (c->fds[0]);
+        if (c->fds[1] >= 0)
+            close (c->fds[1]);
+        if (c->fd >= 0)
+            close (c->fd);
+    }
+}
+
+// Returns 1 when the request is read, 0 if more data is expected and -1 on fail.
+int _server_read_request (struct server_client_t *c)
+{
+    ssize_t n;
+    long max;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE (sizeof (c->fds))];
+    } control;
+
+    if (!c->len)
+    {
+        memset (&msg, 0, sizeof (msg));
+        iov.iov_base = &c->len;
+        iov.iov_len = sizeof (c->len);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof (control.buf);
+        n = recvmsg (c->sock, &msg, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return 0;
+        if (n != sizeof (c->len))
+        {
+            _perror ("recvmsg");
+            return -1;
+        }
+        cmsg = CMSG_FIRSTHDR (&msg);
+        if (!cmsg
+        ||  cmsg->cmsg_level != SOL_SOCKET
+        ||  cmsg->cmsg_type != SCM_RIGHTS
+        ||  cmsg->cmsg_len != CMSG_LEN (sizeof (c->fds)))
+        {
+            _DBG ("Bad request.");
+            return -1;
+        }
+        memcpy (c->fds, CMSG_DATA (cmsg), sizeof (c->fds));
+        _set_cloexec (c->fds[0], false);
+        _set_cloexec (c->fds[1], false);
+
+        // Body is never larger than a command line and a current directory
+        max = sysconf (_SC_ARG_MAX);
+        if (max < SERVER_ARG_MAX)
+            max = SERVER_ARG_MAX;
+        if (!c->len || c->len > (unsigned long) max + PATH_MAX)
+        {
+            _DBG ("Bad request.");
+            return -1;
+        }
+        c->body = malloc (c->len);
+        if (!c->body)
+        {
+            _perror ("malloc");
+            return -1;
+        }
+    }
+
+    while (c->got < c->len)
+    {
+        n = read (c->sock, c->body + c->got, c->len - c->got);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return 0;
+        if (n <= 0)
+        {
+            _DBG ("Bad request.");
+            return -1;
+        }
+        c->got += n;
+    }
+
+    if (c->body[c->len - 1] != '\0')
+    {
+        _DBG ("Bad request.");
+        return -1;
+    }
+    return 1;
+}
+
+// Returns "false" on success (a child process is started to process the
+// request; it must be finished by "_server_finish_child").
+bool _server_start_child (struct server_client_t *c, struct scan_cache_t *caches, server_run_proc_t *run)
+{
+    bool ok;
+    char *p, **argv;
+    int argc, i, pipefd[2], st;
+    pid_t pid;
+    FILE *f;
+    const char *syntax;
+
+    ok = false;
+
+    // Body is a current directory followed by arguments
+    argc = 0;
+    for (p = c->body; p < c->body + c->len; p += strlen (p) + 1)
+        argc++;
+    argv = malloc ((argc + 1) * sizeof (char *));
+    if (!argv)
+    {
+        _perror ("malloc");
+        goto _local_exit;
+    }
+    i = 0;
+    for (p = c->body; p < c->body + c->len; p += strlen (p) + 1)
+        argv[i++] = p;
+    argv[argc] = (char *) NULL;
+
+    // Apply changes reported so far
+    _server_process_events (caches);
+
+    if (pipe (pipefd) < 0)
+    {
+        _perror ("pipe");
+        goto _local_exit;
+    }
+    _set_cloexec (pipefd[0], false);
+    _set_cloexec (pipefd[1], false);
+
+    pid = fork ();
+    if (pid < 0)
+    {
+        _perror ("fork");
+        close (pipefd[0]);
+        close (pipefd[1]);
+        goto _local_exit;
+    }
+
+    if (!pid)
+    {
+        // Child process
+        signal (SIGINT, SIG_DFL);
+        signal (SIGTERM, SIG_DFL);
+        signal (SIGPIPE, SIG_DFL);
+        dup2 (c->fds[0], STDOUT_FILENO);
+        dup2 (c->fds[1], STDERR_FILENO);
+        _server_close_all ();
+        close (pipefd[0]);
+        if (chdir (argv[0]) < 0)
+        {
+            fprintf (stderr, "Failed to change directory to '%s'." NL, argv[0]);
+            _exit (EXIT_FAILURE);
+        }
+        st = run (argc, argv);  // "argv[0]" (directory) is ignored
+        fflush (stdout);
+        fflush (stderr);
+        f = fdopen (pipefd[1], "w");
+        if (f)
+        {
+            for (i = 0; i < SYNTAX_COUNT; i++)
+                if (caches[i].changed && _syntax_to_str (i, &syntax))
+                    scan_cache_write (&caches[i], f, syntax, true);
+            fclose (f);
+        }
+        _exit (st);
+    }
+
+    // Parent process
+    close (pipefd[1]);
+    c->pid = pid;
+    c->fd = pipefd[0];
+
+    ok = true;
+
+_local_exit:
+    if (argv)
+        free (argv);
+    if (ok)
+    {
+        // Only the child needs them
+        close (c->fds[0]);
+        close (c->fds[1]);
+        c->fds[0] = -1;
+        c->fds[1] = -1;
+        free (c->body);
+        c->body = (char *) NULL;
+    }
+    return !ok;
+}
+
+// Merges cache updates of a child process, answers its client and closes it.
+// Updates are sent when the child is done, so this waits for a short time only.
+void _server_finish_child (struct server_client_t *c, struct scan_cache_t *caches)
+{
+    int st, status;
+
+    status = EXIT_FAILURE;
+    _server_read_updates (c->fd, caches);
+    c->fd = -1;
+    if (waitpid (c->pid, &st, 0) == c->pid && WIFEXITED (st))
+        status = WEXITSTATUS (st);
+    _server_client_close (c, status);
+}
+
+int server_main (const char *name, struct scan_cache_t *caches, server_run_proc_t *run)
+{
+    int status;
+    struct sockaddr_un addr;
+    struct stat st;
+    struct sigaction sa;
+    struct pollfd pfd[2 + SERVER_CLIENTS_MAX];
+    struct server_client_t *c;
+    unsigned n;
+    long long now;
+    int timeout, r;
+
+    status = EXIT_FAILURE;
+
+    if (!_make_address (name, &addr))
+    {
+        fprintf (stderr, "Socket name '%s' is too long." NL, name);
+        goto _local_exit;
+    }
+
+    // Remove a stale socket left by a previous server
+    if (!lstat (name, &st) && S_ISSOCK (st.st_mode))
+        unlink (name);
+
+    _server_sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (_server_sock < 0
+    ||  !_set_cloexec (_server_sock, false)
+    ||  bind (_server_sock, (struct sockaddr *) &addr, sizeof (addr)) < 0
+    ||  listen (_server_sock, SERVER_BACKLOG) < 0)
+    {
+        fprintf (stderr, "Failed to listen on '%s': %s." NL, name, strerror (errno));
+        goto _local_exit;
+    }
+
+#if defined (__linux__)
+    _server_inotify = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (_server_inotify < 0)
+        _perror ("inotify_init1");
+#endif  // __linux__
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = _server_signal;
+    sigemptyset (&sa.sa_mask);
+    sigaction (SIGINT, &sa, NULL);
+    sigaction (SIGTERM, &sa, NULL);
+    signal (SIGPIPE, SIG_IGN);
+
+    // Requests are read as their data arrives and are processed by child
+    // processes at once, their cache updates are merged as they exit
+    while (!_server_stop)
+    {
+        // Negative descriptors are ignored by "poll"
+        pfd[0].fd = _server_clients_count < SERVER_CLIENTS_MAX ? _server_sock : -1;
+        pfd[0].events = POLLIN;
+        pfd[1].fd = _server_inotify;
+        pfd[1].events = POLLIN;
+        timeout = -1;
+        now = _server_now ();
+        for (n = 0; n < _server_clients_count; n++)
+        {
+            c = &_server_clients[n];
+            pfd[2 + n].fd = c->pid ? c->fd : c->sock;
+            pfd[2 + n].events = POLLIN;
+            if (!c->pid)
+            {
+                r = c->deadline > now ? c->deadline - now : 0;
+                if (timeout < 0 || r < timeout)
+                    timeout = r;
+            }
+        }
+        if (poll (pfd, 2 + _server_clients_count, timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            _perror ("poll");
+            goto _local_exit;
+        }
+        if (pfd[1].revents & POLLIN)
+            _server_process_events (caches);
+        now = _server_now ();
+        for (n = _server_clients_count; n--;)
+        {
+            c = &_server_clients[n];
+            if (c->pid)
+            {
+                if (!pfd[2 + n].revents)
+                    continue;
+                _server_finish_child (c, caches);
+            }
+            else
+            {
+                r = pfd[2 + n].revents ? _server_read_request (c) : 0;
+                if (!r && now >= c->deadline)
+                {
+                    _DBG ("Request timed out.");
+                    r = -1;
+                }
+                if (r > 0 && _server_start_child (c, caches, run))
+                    r = -1;
+                if (r >= 0)
+                    continue;   // being read or processed
+                _server_client_close (c, EXIT_FAILURE);
+            }
+            *c = _server_clients[--_server_clients_count];
+        }
+        if (pfd[0].revents & POLLIN)
+        {
+            c = &_server_clients[_server_clients_count];
+            c->sock = accept (_server_sock, NULL, NULL);
+            if (c->sock < 0)
+                continue;
+            if (!_set_cloexec (c->sock, true))
+            {
+                _perror ("fcntl");
+                close (c->sock);
+                continue;
+            }
+            c->fds[0] = -1;
+            c->fds[1] = -1;
+            c->len = 0;
+            c->got = 0;
+            c->body = (char *) NULL;
+            c->deadline = _server_now () + SERVER_TIMEOUT * 1000LL;
+            c->pid = 0;
+            c->fd = -1;
+            _server_clients_count++;
+        }
+    }
+
+    status = EXIT_SUCCESS;
+
+_local_exit:
+    while (_server_clients_count)
+    {
+        c = &_server_clients[--_server_clients_count];
+        if (c->pid)
+            _server_finish_child (c, caches);
+        else
+            _server_client_close (c, EXIT_FAILURE);
+    }
+    if (_server_inotify >= 0)
+    {
+        close (_server_inotify);
+        _server_inotify = -1;
+    }
+    if (_server_dirs)
+    {
+        for (n = 0; n < _server_dirs_count; n++)
+            if (_server_dirs[n])
+                free (_server_dirs[n]);
+        free (_server_dirs);
+        _server_dirs = (char **) NULL;
+        _server_dirs_count = 0;
+    }
+    if (_server_sock >= 0)
+    {
+        close (_server_sock);
+        _server_sock = -1;
+        unlink (name);
+    }
+    return status;
+}
+
+#else   // defined (_WIN32) || defined(_WIN64)
+
+int server_main (const char *name, struct scan_cache_t *caches, server_run_proc_t *run)
+{
+    fprintf (stderr, "Server mode is not supported on this system." NL);
+    return EXIT_FAILURE;
+}
+
+int client_main (const char *name, int argc, char **argv)
+{
+    return -1;  // Server is not available
+}
+
+#endif  // defined (_WIN32) || defined(_WIN64)
@@ -0,0 +1,29 @@
+/* server.h - declarations for "server.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _SERVER_H_INCLUDED
+#define _SERVER_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include "l_cache.h"
+
+// Processes a command line and returns exit status ("argv[0]" is ignored).
+typedef int server_run_proc_t (int argc, char **argv);
+
+// Serves requests on a local socket "name" until interrupted.
+// Every request is processed by "run" in a child process which inherits
+// "caches" (indexed by syntax) and sends back what it has scanned. Only
+// included files lists of scanned files are kept between requests: sources,
+// probes and directory listings are made again by every request.
+// Returns exit status.
+int server_main (const char *name, struct scan_cache_t *caches, server_run_proc_t *run);
+
+// Forwards a command line to a server listening on a local socket "name".
+// Returns exit status of the request or -1 if server is not available.
+int client_main (const char *name, int argc, char **argv);
+
+#endif  // !_SERVER_H_INCLUDED
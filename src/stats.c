@@ -0,0 +1,133 @@
+/* stats.c - run statistics.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include "stats.h"
+
+bool stats_enabled;
+unsigned long long stats_counters[STAT_COUNT];
+
+struct stats_phase_t
+{
+    long long wall;
+    long long cpu;
+    unsigned long long count;
+};
+
+struct stats_phase_t _stats_phases[STATS_PHASE_COUNT];
+struct stats_timer_t _stats_run;
+
+const char *_stats_counter_names[STAT_COUNT] =
+{
+    "files loaded",
+    "bytes read",
+    "lines scanned",
+    "lines parsed",
+    "directives matched",
+    "stat calls",
+    "probe cache hits",
+    "directory listing hits",
+    "paths normalized",
+    "arena allocations",
+    "arena chunks"
+};
+
+const char *_stats_phase_names[STATS_PHASE_COUNT] =
+{
+    "load",
+    "scan",
+    "resolve",
+    "write"
+};
+
+#if !defined (_WIN32) && !defined(_WIN64)
+
+long long _stats_clock (clockid_t id)
+{
+    struct timespec ts;
+
+    if (clock_gettime (id, &ts))
+        return 0;
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+# define _stats_wall()       _stats_clock (CLOCK_MONOTONIC)
+# define _stats_thread_cpu() _stats_clock (CLOCK_THREAD_CPUTIME_ID)
+# define _stats_process_cpu() _stats_clock (CLOCK_PROCESS_CPUTIME_ID)
+
+#else   // defined (_WIN32) || defined(_WIN64)
+
+// Only process time is known
+# define _stats_wall()       ((long long) clock () * (1000000000LL / CLOCKS_PER_SEC))
+# define _stats_thread_cpu() _stats_wall ()
+# define _stats_process_cpu() _stats_wall ()
+
+#endif  // defined (_WIN32) || defined(_WIN64)
+
+void stats_begin (struct stats_timer_t *self)
+{
+    if (!stats_enabled)
+        return;
+
+    self->wall = _stats_wall ();
+    self->cpu = _stats_thread_cpu ();
+}
+
+void stats_end (struct stats_timer_t *self, unsigned phase)
+{
+    struct stats_phase_t *p;
+
+    if (!stats_enabled)
+        return;
+
+    p = &_stats_phases[phase];
+    __atomic_fetch_add (&p->wall, _stats_wall () - self->wall, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&p->cpu, _stats_thread_cpu () - self->cpu, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&p->count, 1, __ATOMIC_RELAXED);
+}
+
+void stats_start (void)
+{
+    stats_enabled = true;
+    _stats_run.wall = _stats_wall ();
+    _stats_run.cpu = _stats_process_cpu ();
+}
+
+bool stats_print (FILE *stream)
+{
+    unsigned i;
+
+    if (!stats_enabled)
+        return false;
+
+    if (fprintf (stream, "Statistics:" NL) < 0)
+        return true;
+
+    for (i = 0; i < STAT_COUNT; i++)
+        if (fprintf (stream, "  %-24s %12llu" NL, _stats_counter_names[i], stats_counters[i]) < 0)
+            return true;
+
+    // Phases run by worker threads are summed up
+    if (fprintf (stream, "  %-24s %12s %12s %12s" NL, "phase", "times", "wall, ms", "cpu, ms") < 0)
+        return true;
+
+    for (i = 0; i < STATS_PHASE_COUNT; i++)
+        if (fprintf (stream, "  %-24s %12llu %12.3f %12.3f" NL, _stats_phase_names[i],
+            _stats_phases[i].count,
+            _stats_phases[i].wall / 1e6,
+            _stats_phases[i].cpu / 1e6) < 0)
+            return true;
+
+    if (fprintf (stream, "  %-24s %12s %12.3f %12.3f" NL, "total", "",
+        (_stats_wall () - _stats_run.wall) / 1e6,
+        (_stats_process_cpu () - _stats_run.cpu) / 1e6) < 0)
+        return true;
+
+    return false;
+}
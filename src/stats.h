@@ -0,0 +1,70 @@
+/* stats.h - declarations for "stats.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _STATS_H_INCLUDED
+#define _STATS_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Run statistics ("--stats" option)
+// Counters may be changed by any thread. Nothing is done unless enabled.
+
+// Counters
+
+#define STAT_FILES_LOADED   0
+#define STAT_BYTES_READ     1
+#define STAT_LINES_SCANNED  2   // lines of scanned files
+#define STAT_LINES_PARSED   3   // lines containing a directive key (prefiltered)
+#define STAT_DIRECTIVES     4   // directives matched
+#define STAT_STAT_CALLS     5   // "stat" system calls on paths
+#define STAT_PROBE_HITS     6   // probes answered by cache
+#define STAT_LISTING_HITS   7   // lookups answered by directory listings
+#define STAT_NORMALIZATIONS 8   // paths normalized
+#define STAT_ALLOCATIONS    9   // arena allocations
+#define STAT_CHUNKS         10  // arena chunks allocated
+#define STAT_COUNT          11
+
+// Phases
+
+#define STATS_PHASE_LOAD    0   // loading files
+#define STATS_PHASE_SCAN    1   // scanning lines for directives
+#define STATS_PHASE_RESOLVE 2   // resolving included files
+#define STATS_PHASE_WRITE   3   // making and writing rules
+#define STATS_PHASE_COUNT   4
+
+extern bool stats_enabled;
+extern unsigned long long stats_counters[STAT_COUNT];
+
+static inline __attribute__ ((always_inline))
+void stats_add (unsigned counter, unsigned long long n)
+{
+    if (stats_enabled)
+        __atomic_fetch_add (&stats_counters[counter], n, __ATOMIC_RELAXED);
+}
+
+// Phase timer (on stack of a thread)
+
+struct stats_timer_t
+{
+    long long wall;     // in nanoseconds
+    long long cpu;      // in nanoseconds (of calling thread)
+};
+
+// Starts timing a phase if statistics are enabled.
+void stats_begin (struct stats_timer_t *self);
+
+// Adds time passed since "stats_begin" to a phase.
+void stats_end (struct stats_timer_t *self, unsigned phase);
+
+// Enables statistics and starts timing the whole run.
+void stats_start (void);
+
+// Returns "false" on success.
+bool stats_print (FILE *stream);
+
+#endif  // !_STATS_H_INCLUDED
@@ -0,0 +1,100 @@
+/* strbuf.c - growing string buffer structure.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "strbuf.h"
+
+#define STRBUF_SIZE_MIN 256
+
+void
+    strbuf_clear
+    (
+        struct strbuf_t *self
+    )
+{
+    self->data = (char *) NULL;
+    self->len = 0;
+    self->size = 0;
+}
+
+bool
+    strbuf_add
+    (
+        struct strbuf_t *self,
+        const char *s,
+        size_t len
+    )
+{
+    char *p;
+    size_t size;
+
+    if (!self || (!s && len))
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    if (self->size - self->len < len)
+    {
+        size = self->size ? self->size : STRBUF_SIZE_MIN;
+        while (size - self->len < len)
+            size *= 2;
+        p = realloc (self->data, size);
+        if (!p)
+        {
+            _perror ("realloc");
+            return true;
+        }
+        self->data = p;
+        self->size = size;
+    }
+
+    memcpy (self->data + self->len, s, len);
+    self->len += len;
+    return false;
+}
+
+bool
+    strbuf_add_str
+    (
+        struct strbuf_t *self,
+        const char *s
+    )
+{
+    if (!s)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    return strbuf_add (self, s, strlen (s));
+}
+
+bool
+    strbuf_add_char
+    (
+        struct strbuf_t *self,
+        char c
+    )
+{
+    return strbuf_add (self, &c, 1);
+}
+
+void
+    strbuf_free
+    (
+        struct strbuf_t *self
+    )
+{
+    if (self->data)
+        free (self->data);
+    strbuf_clear (self);
+}
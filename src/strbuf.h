@@ -0,0 +1,65 @@
+/* strbuf.h - declarations for "strbuf.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _STRBUF_H_INCLUDED
+#define _STRBUF_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Growing string buffer structure
+// Text is collected in memory to be written out at once.
+
+struct strbuf_t
+{
+    char *data;         // not zero-terminated
+    size_t len;
+    size_t size;        // allocated
+};
+
+void
+    strbuf_clear
+    (
+        struct strbuf_t *self
+    );
+
+// Returns "false" on success.
+// "s" of "len" characters is not required to be zero-terminated.
+bool
+    strbuf_add
+    (
+        struct strbuf_t *self,
+        const char *s,
+        size_t len
+    );
+
+// Returns "false" on success.
+bool
+    strbuf_add_str
+    (
+        struct strbuf_t *self,
+        const char *s
+    );
+
+// Returns "false" on success.
+bool
+    strbuf_add_char
+    (
+        struct strbuf_t *self,
+        char c
+    );
+
+// Appends zero-terminated "s" (possibly converted) to "self".
+typedef bool strbuf_add_proc_t (struct strbuf_t *self, const char *s);
+
+void
+    strbuf_free
+    (
+        struct strbuf_t *self
+    );
+
+#endif  // !_STRBUF_H_INCLUDED
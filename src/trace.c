@@ -0,0 +1,171 @@
+/* trace.c - trace of processing.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <pthread.h>
+#endif
+#include "platform.h"
+#include "strbuf.h"
+#include "trace.h"
+
+bool trace_enabled;
+
+const char *_trace_name;
+long long _trace_start;
+unsigned _trace_pid;
+unsigned _trace_tids;           // last thread id given
+__thread unsigned _trace_tid;   // 0 if not given yet
+struct strbuf_t _trace_events;  // comma-separated events
+bool _trace_failed;
+
+#if !defined (_WIN32) && !defined(_WIN64)
+
+pthread_mutex_t _trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+# define _trace_lock()      pthread_mutex_lock (&_trace_lock)
+# define _trace_unlock()    pthread_mutex_unlock (&_trace_lock)
+
+long long _trace_clock (void)
+{
+    struct timespec ts;
+
+    if (clock_gettime (CLOCK_MONOTONIC, &ts))
+        return 0;
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#else   // defined (_WIN32) || defined(_WIN64)
+
+// There are no worker threads
+# define _trace_lock()
+# define _trace_unlock()
+
+# define _trace_clock()     ((long long) clock () * (1000000000LL / CLOCKS_PER_SEC))
+
+#endif  // defined (_WIN32) || defined(_WIN64)
+
+// Returns "false" on success.
+// Adds "s" as a JSON string.
+bool _trace_add_str (struct strbuf_t *buf, const char *s)
+{
+    char esc[8];
+    const char *e;
+
+    if (strbuf_add_char (buf, '"'))
+        return true;
+
+    for (;;)
+    {
+        e = s;
+        while (*e != '\0' && *e != '"' && *e != '\\' && (unsigned char) *e >= ' ')
+            e++;
+        if (e != s && strbuf_add (buf, s, e - s))
+            return true;
+        if (*e == '\0')
+            break;
+        if (*e == '"' || *e == '\\')
+            snprintf (esc, sizeof (esc), "\\%c", *e);
+        else
+            snprintf (esc, sizeof (esc), "\\u%04x", (unsigned char) *e);
+        if (strbuf_add_str (buf, esc))
+            return true;
+        s = e + 1;
+    }
+
+    return strbuf_add_char (buf, '"');
+}
+
+void trace_begin (struct trace_span_t *self)
+{
+    if (!trace_enabled)
+        return;
+
+    self->start = _trace_clock ();
+}
+
+void trace_end (struct trace_span_t *self, const char *name, const char *file, long long bytes, long includes)
+{
+    char buf[128];
+    long long end;
+    struct strbuf_t *p;
+    bool failed;
+
+    if (!trace_enabled)
+        return;
+
+    end = _trace_clock ();
+    if (!_trace_tid)
+        _trace_tid = __atomic_add_fetch (&_trace_tids, 1, __ATOMIC_RELAXED);
+
+    _trace_lock ();
+    p = &_trace_events;
+    // Times are in microseconds
+    snprintf (buf, sizeof (buf), "%s" NL "{\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+        p->len ? "," : "", _trace_pid, _trace_tid,
+        (self->start - _trace_start) / 1e3, (end - self->start) / 1e3);
+    failed = strbuf_add_str (p, buf)
+          || _trace_add_str (p, name)
+          || strbuf_add_str (p, ",\"args\":{\"file\":")
+          || _trace_add_str (p, file ? file : "");
+    if (!failed && bytes >= 0)
+    {
+        snprintf (buf, sizeof (buf), ",\"bytes\":%lld", bytes);
+        failed = strbuf_add_str (p, buf);
+    }
+    if (!failed && includes >= 0)
+    {
+        snprintf (buf, sizeof (buf), ",\"includes\":%ld", includes);
+        failed = strbuf_add_str (p, buf);
+    }
+    if (failed || strbuf_add_str (p, "}}"))
+        _trace_failed = true;
+    _trace_unlock ();
+}
+
+bool trace_start (const char *name)
+{
+    if (!name)
+        return false;
+
+    _trace_name = name;
+    _trace_start = _trace_clock ();
+    _trace_pid = getpid ();
+    _trace_tid = ++_trace_tids;         // caller is the main thread
+    strbuf_clear (&_trace_events);
+    _trace_failed = false;
+    trace_enabled = true;
+    return true;
+}
+
+bool trace_save (void)
+{
+    struct strbuf_t buf;
+    bool ok;
+
+    if (!trace_enabled)
+        return true;
+
+    _trace_lock ();
+    trace_enabled = false;
+    _trace_unlock ();
+
+    strbuf_clear (&buf);
+    ok = !_trace_failed
+      && !strbuf_add_str (&buf, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[")
+      && (!_trace_events.len || !strbuf_add (&buf, _trace_events.data, _trace_events.len))
+      && !strbuf_add_str (&buf, NL "]}" NL)
+      && write_file_if_changed (_trace_name, buf.data, buf.len, NULL);
+
+    strbuf_free (&buf);
+    strbuf_free (&_trace_events);
+    return ok;
+}
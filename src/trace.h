@@ -0,0 +1,39 @@
+/* trace.h - declarations for "trace.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _TRACE_H_INCLUDED
+#define _TRACE_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+
+// Trace of processing ("--trace" option)
+// Spans are written as Chrome trace events (JSON) which may be opened by
+// "chrome://tracing" or Perfetto. Spans may be ended by any thread.
+
+extern bool trace_enabled;
+
+// Span (on stack of a thread)
+
+struct trace_span_t
+{
+    long long start;    // in nanoseconds
+};
+
+// Starts a span if tracing is enabled.
+void trace_begin (struct trace_span_t *self);
+
+// Records a span started by "trace_begin" with arguments "file", "bytes" and
+// "includes" (the last two are omitted when negative).
+void trace_end (struct trace_span_t *self, const char *name, const char *file, long long bytes, long includes);
+
+// Enables tracing to file "name". Returns "true" on success.
+bool trace_start (const char *name);
+
+// Writes recorded spans to file. Returns "true" on success.
+bool trace_save (void);
+
+#endif  // !_TRACE_H_INCLUDED
@@ -0,0 +1,237 @@
+/* workers.c - worker threads pool structure.
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#include "defs.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <pthread.h>
+#endif
+#include "debug.h"
+#include "workers.h"
+
+#if !defined (_WIN32) && !defined(_WIN64)
+
+void *_workers_thread (void *arg)
+{
+    struct workers_t *self;
+    struct worker_job_t *job;
+
+    self = arg;
+
+    pthread_mutex_lock (&self->lock);
+    for (;;)
+    {
+        while (!self->first && !self->stop)
+            pthread_cond_wait (&self->queued, &self->lock);
+        if (self->stop)
+            break;
+        job = self->first;
+        self->first = job->next;
+        if (!self->first)
+            self->last = (struct worker_job_t *) NULL;
+        pthread_mutex_unlock (&self->lock);
+
+        self->proc (job);
+
+        pthread_mutex_lock (&self->lock);
+        job->done = true;
+        pthread_cond_broadcast (&self->done);
+    }
+    pthread_mutex_unlock (&self->lock);
+    return NULL;
+}
+
+bool
+    workers_start
+    (
+        struct workers_t *self,
+        unsigned count,
+        worker_proc_t *proc
+    )
+{
+    unsigned i;
+
+    if (!self || !proc)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    self->proc = proc;
+    self->count = 0;
+    self->first = (struct worker_job_t *) NULL;
+    self->last = (struct worker_job_t *) NULL;
+    self->stop = false;
+    self->threads = (pthread_t *) NULL;
+
+    if (!count)
+        return false;   // Success (no threads)
+
+    self->threads = malloc (count * sizeof (pthread_t));
+    if (!self->threads)
+    {
+        _perror ("malloc");
+        return true;
+    }
+
+    pthread_mutex_init (&self->lock, NULL);
+    pthread_cond_init (&self->queued, NULL);
+    pthread_cond_init (&self->done, NULL);
+
+    for (i = 0; i < count; i++)
+    {
+        if (pthread_create (&self->threads[i], NULL, _workers_thread, self))
+        {
+            _DBG ("Failed to create a thread.");
+            break;      // use what we have
+        }
+    }
+    self->count = i;
+
+    if (!self->count)
+    {
+        // Run jobs by caller
+        pthread_cond_destroy (&self->done);
+        pthread_cond_destroy (&self->queued);
+        pthread_mutex_destroy (&self->lock);
+        free (self->threads);
+        self->threads = (pthread_t *) NULL;
+    }
+
+    _DBG_ ("Started %u worker threads.", self->count);
+
+    return false;
+}
+
+void
+    workers_submit
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    )
+{
+    job->next = (struct worker_job_t *) NULL;
+    job->done = false;
+
+    if (!self->count)
+    {
+        self->proc (job);
+        job->done = true;
+        return;
+    }
+
+    pthread_mutex_lock (&self->lock);
+    if (self->last)
+        self->last->next = job;
+    else
+        self->first = job;
+    self->last = job;
+    pthread_cond_signal (&self->queued);
+    pthread_mutex_unlock (&self->lock);
+}
+
+void
+    workers_wait
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    )
+{
+    if (!self->count)
+        return;
+
+    pthread_mutex_lock (&self->lock);
+    while (!job->done)
+        pthread_cond_wait (&self->done, &self->lock);
+    pthread_mutex_unlock (&self->lock);
+}
+
+void
+    workers_stop
+    (
+        struct workers_t *self
+    )
+{
+    unsigned i;
+
+    if (!self->count)
+        return;
+
+    pthread_mutex_lock (&self->lock);
+    self->stop = true;
+    self->first = (struct worker_job_t *) NULL;
+    self->last = (struct worker_job_t *) NULL;
+    pthread_cond_broadcast (&self->queued);
+    pthread_mutex_unlock (&self->lock);
+
+    for (i = 0; i < self->count; i++)
+        pthread_join (self->threads[i], NULL);
+
+    pthread_cond_destroy (&self->done);
+    pthread_cond_destroy (&self->queued);
+    pthread_mutex_destroy (&self->lock);
+    free (self->threads);
+    self->threads = (pthread_t *) NULL;
+    self->count = 0;
+}
+
+#else   // defined (_WIN32) || defined(_WIN64)
+
+// Jobs are always run by caller.
+
+bool
+    workers_start
+    (
+        struct workers_t *self,
+        unsigned count,
+        worker_proc_t *proc
+    )
+{
+    if (!self || !proc)
+    {
+        _DBG ("Bad arguments.");
+        return true;
+    }
+
+    self->proc = proc;
+    self->count = 0;
+    self->first = (struct worker_job_t *) NULL;
+    self->last = (struct worker_job_t *) NULL;
+    self->stop = false;
+    return false;
+}
+
+void
+    workers_submit
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    )
+{
+    job->next = (struct worker_job_t *) NULL;
+    self->proc (job);
+    job->done = true;
+}
+
+void
+    workers_wait
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    )
+{
+}
+
+void
+    workers_stop
+    (
+        struct workers_t *self
+    )
+{
+}
+
+#endif  // defined (_WIN32) || defined(_WIN64)
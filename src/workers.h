@@ -0,0 +1,79 @@
+/* workers.h - declarations for "workers.c".
+
+   This is free and unencumbered software released into the public domain.
+   For more information, please refer to <http://unlicense.org>. */
+
+#ifndef _WORKERS_H_INCLUDED
+#define _WORKERS_H_INCLUDED
+
+#include "defs.h"
+
+#include <stdbool.h>
+#if !defined (_WIN32) && !defined(_WIN64)
+# include <pthread.h>
+#endif
+
+// Worker threads pool structure
+
+// Job (embedded into caller's structure)
+
+struct worker_job_t
+{
+    struct worker_job_t *next;
+    bool done;
+};
+
+typedef void worker_proc_t (struct worker_job_t *job);
+
+// Pool
+
+struct workers_t
+{
+    worker_proc_t *proc;
+    unsigned count;     // number of threads (0 if jobs are run by caller)
+    struct worker_job_t *first;         // queued jobs
+    struct worker_job_t *last;
+    bool stop;
+#if !defined (_WIN32) && !defined(_WIN64)
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      // a job was queued or pool is stopping
+    pthread_cond_t done;        // a job was done
+#endif
+};
+
+// Returns "false" on success.
+// Starts "count" threads running "proc" on submitted jobs. With "count" of 0
+// (or where threads are not supported) jobs are run by "workers_submit".
+bool
+    workers_start
+    (
+        struct workers_t *self,
+        unsigned count,
+        worker_proc_t *proc
+    );
+
+// Queues a job. Jobs are started in order of submission.
+void
+    workers_submit
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    );
+
+// Waits until a submitted job is done.
+void
+    workers_wait
+    (
+        struct workers_t *self,
+        struct worker_job_t *job
+    );
+
+// Drops jobs not yet started, waits for running ones and stops threads.
+void
+    workers_stop
+    (
+        struct workers_t *self
+    );
+
+#endif  // !_WORKERS_H_INCLUDED